@@ -7,15 +7,18 @@
 
 // inputs from vertex shader
 in vec2 tc;	// used for texture coordinate visualization
+in vec4 color;	// circle's color
+in vec2 disc;	// position in the unit disc
 
 // output of the fragment shader
 out vec4 fragColor;
 
 // shader's global variables, called the uniform variables
 uniform bool b_solid_color;
-uniform vec4 solid_color;
+uniform bool b_impostor;	// is the circle a quad to be cut out?
 
 void main()
 {
-	fragColor = b_solid_color ? solid_color : vec4(tc.xy,0,1);
+	if(b_impostor&&dot(disc,disc)>1.0) discard;	// exactly round at any size, unlike the tessellated mesh
+	fragColor = b_solid_color ? color : vec4(tc.xy,0,1);
 }
\ No newline at end of file
@@ -3,20 +3,47 @@ layout(location=0) in vec3 position;
 layout(location=1) in vec3 normal;
 layout(location=2) in vec2 texcoord;
 
+// per-instance attributes for the instanced path
+layout(location=3) in vec3 instance_circle;	// center.xy and radius
+layout(location=4) in vec4 instance_color;	// RGBA color
+
 // outputs of vertex shader = input to fragment shader
 // out vec4 gl_Position: a built-in output variable that should be written in main()
 out vec3 norm;	// the second output: not used yet
 out vec2 tc;	// the third output: not used yet
+out vec4 color;	// circle's color
+out vec2 disc;	// position in the unit disc, tested per fragment by impostors
 
 // uniform variables
+uniform bool	b_instanced;	// read the circle from the instance attributes?
+uniform bool	b_impostor;		// draw a quad around the unit disc from gl_VertexID instead of the mesh?
 uniform mat4	model_matrix;	// 4x4 transformation matrix: explained later in the lecture
 uniform mat4	aspect_matrix;	// tricky 4x4 aspect-correction matrix
+uniform vec4	solid_color;
+uniform uint	vertex_format;	// 0: float, 1: octahedral normal, 2: 10:10:10:2 normal, 3: position only
+
+// inverse of the octahedral map: unfold the lower hemisphere over the diagonals
+vec3 oct_decode( vec2 e )
+{
+	vec3 n = vec3(e,1.0-abs(e.x)-abs(e.y));
+	float t = max(-n.z,0.0);
+	n.xy += vec2(n.x>=0.0?-t:t,n.y>=0.0?-t:t);
+	return normalize(n);
+}
 
 void main()
 {
-	gl_Position = aspect_matrix*model_matrix*vec4(position,1);
+	// impostor: four corners of a triangle strip; the fragment shader cuts out the disc
+	vec3 p = b_impostor ? vec3(vec2(float(gl_VertexID&1),float(gl_VertexID>>1))*2.0-1.0,0) : position;
+
+	// instanced path: scale by the radius and translate to the center, as circle_t::update() does
+	vec4 wpos = b_instanced ? vec4(p.xy*instance_circle.z+instance_circle.xy,p.z,1) : model_matrix*vec4(p,1);
+	gl_Position = aspect_matrix*wpos;
 
 	// other outputs to rasterizer/fragment shader
-	norm = normal;
-	tc = texcoord;
+	// a position-only circle has the constant normal and texcoords mapped from its unit disk
+	norm = b_impostor||vertex_format==3u ? vec3(0,0,-1) : vertex_format==1u ? oct_decode(normal.xy) : normal;
+	tc = b_impostor||vertex_format==3u ? p.xy*0.5+0.5 : texcoord;
+	disc = p.xy;
+	color = b_instanced ? instance_color : solid_color;
 }
\ No newline at end of file
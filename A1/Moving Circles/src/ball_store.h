@@ -0,0 +1,32 @@
+#pragma once
+#ifndef __BALL_STORE_H__
+#define __BALL_STORE_H__
+#include "circle.h"
+
+//*************************************
+// structure-of-arrays storage of the simulated balls
+// velocities are cartesian in arena units per second
+struct ball_store
+{
+	std::vector<float>	x, y;		// centers
+	std::vector<float>	vx, vy;		// velocities
+	std::vector<float>	radius;		// radii
+	std::vector<vec4>	color;		// RGBA colors in [0,1]
+
+	size_t	size() const { return x.size(); }
+	void	reserve( size_t n ){ x.reserve(n); y.reserve(n); vx.reserve(n); vy.reserve(n); radius.reserve(n); color.reserve(n); }
+	void	push_back( const circle_t& c );
+};
+
+inline void ball_store::push_back( const circle_t& c )
+{
+	// polar (speed, theta) to cartesian; the factor 3 is the speed scale of the original integration
+	x.push_back( c.center.x );
+	y.push_back( c.center.y );
+	vx.push_back( c.speed * cos(c.theta) * 3 );
+	vy.push_back( c.speed * sin(c.theta) * 3 );
+	radius.push_back( c.radius );
+	color.push_back( c.color );
+}
+
+#endif // __BALL_STORE_H__
@@ -0,0 +1,255 @@
+#pragma once
+#ifndef __BENCH_H__
+#define __BENCH_H__
+#include <chrono>
+#include <cstring>
+#include "circle_world.h"
+
+//*************************************
+// headless NUM_OF_BALLS sweep: brute-force vs. grid broadphase
+// run with "--bench"; no window or GL context is created
+inline double bench_collision( std::vector<circle_t> circles, bool b_grid, int steps, collision_stats& stats )
+{
+	circle_world world(circles);
+	world.b_grid = b_grid;
+	auto t0 = std::chrono::high_resolution_clock::now();
+	for( int k=0; k < steps; k++ )
+	{
+		world.step();
+		stats.pairs += world.stats.pairs;
+		stats.contacts += world.stats.contacts;
+	}
+	auto t1 = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double,std::milli>(t1-t0).count()/steps;
+}
+
+inline void run_collision_benchmark()
+{
+	static const uint sweep[] = { 1000, 10000, 100000 };
+
+	printf( "%8s %12s %16s %12s\n", "balls", "path", "pairs/step", "ms/step" );
+	for( uint n : sweep )
+	{
+		auto circles = create_circles(n,1234);	// the same scene for both paths
+
+		// fewer brute-force steps for large scenes (a single 100k step takes more than a minute)
+		int brute_steps = std::max(1,int(2e8/(double(n)*n)));
+		int grid_steps = 100;
+
+		collision_stats brute, grid;
+		double brute_ms = bench_collision( circles, false, brute_steps, brute );
+		double grid_ms = bench_collision( circles, true, grid_steps, grid );
+		printf( "%8u %12s %16zu %12.3f\n", n, "brute-force", brute.pairs/brute_steps, brute_ms );
+		printf( "%8u %12s %16zu %12.3f\n", n, "grid", grid.pairs/grid_steps, grid_ms );
+	}
+}
+
+//*************************************
+// headless fixed-step run: "--simulate [seconds] [balls]"
+// the checksum of the final state is identical for the same seed on every run
+inline void run_simulation( float seconds, uint num_balls, uint seed=1234 )
+{
+	circle_world world(create_circles(num_balls,seed));
+	size_t steps = size_t(seconds/world.dt+0.5f);
+
+	auto t0 = std::chrono::high_resolution_clock::now();
+	for( size_t k=0; k < steps; k++ ) world.step();
+	auto t1 = std::chrono::high_resolution_clock::now();
+	double ms = std::chrono::duration<double,std::milli>(t1-t0).count();
+
+	double checksum = 0;
+	for( size_t k=0; k < world.balls.size(); k++ ) checksum += world.balls.x[k]*3.0 + world.balls.y[k]*7.0;
+	printf( "%u balls, %zu steps at %.0f Hz in %.1f ms (%.1f steps/s), checksum %.9f\n", num_balls, steps, 1/world.dt, ms, steps/ms*1000.0, checksum );
+}
+
+//*************************************
+// integration microbenchmark: "--bench-integrate"
+// the array-of-structures path is the original per-frame update of circle_t
+inline void integrate_circles_aos( std::vector<circle_t>& circles, float dt )
+{
+	for (size_t j = 0; j < circles.size(); j++) {
+		circles.at(j).center.x = circles.at(j).center.x + circles.at(j).speed * cos(circles.at(j).theta) * dt * 3;
+		circles.at(j).center.y = circles.at(j).center.y + circles.at(j).speed * sin(circles.at(j).theta) * dt * 3;
+		circles.at(j).update();
+	}
+}
+
+template <class F> double bench_ms_per_step( int steps, F step )
+{
+	auto t0 = std::chrono::high_resolution_clock::now();
+	for( int k=0; k < steps; k++ ) step();
+	auto t1 = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double,std::milli>(t1-t0).count()/steps;
+}
+
+inline void run_integration_benchmark()
+{
+	static const uint sweep[] = { 100000, 1000000 };
+	const float dt = 1/240.0f;
+	const int steps = 50;
+
+#if defined(__AVX2__)
+	const char* simd = "soa-avx2";
+#elif defined(CG_SSE2)
+	const char* simd = "soa-sse2";
+#else
+	const char* simd = "soa-scalar";
+#endif
+	printf( "%8s %12s %12s %14s\n", "balls", "path", "ms/step", "Mballs/s" );
+	for( uint n : sweep )
+	{
+		auto circles = create_circles(n,1234);
+		ball_store scalar, vectorized;
+		scalar.reserve(n); for( auto& c : circles ) scalar.push_back(c);
+		vectorized = scalar;
+
+		double ms[3];
+		ms[0] = bench_ms_per_step( steps, [&](){ integrate_circles_aos( circles, dt ); } );
+		ms[1] = bench_ms_per_step( steps, [&](){ integrate_balls_scalar( scalar, dt, 0, scalar.size() ); } );
+		ms[2] = bench_ms_per_step( steps, [&](){ integrate_balls( vectorized, dt ); } );
+
+		const char* names[] = { "aos", "soa-scalar", simd };
+		for( int k=0; k < 3; k++ ) printf( "%8u %12s %12.3f %14.1f\n", n, names[k], ms[k], n/ms[k]/1000.0 );
+	}
+}
+
+//*************************************
+// thread scaling of the simulation: "--bench-threads [balls]"
+// every thread count must reproduce the single-threaded state bit by bit
+inline uint64_t hash_balls( const ball_store& b )
+{
+	uint64_t h = 1469598103934665603ull;	// FNV-1a over the raw bits
+	auto mix = [&]( const std::vector<float>& v ){ for( float f : v ){ uint32_t u; memcpy(&u,&f,4); h = (h^u)*1099511628211ull; } };
+	mix(b.x); mix(b.y); mix(b.vx); mix(b.vy);
+	return h;
+}
+
+inline void run_thread_benchmark( uint num_balls )
+{
+	const int steps = 20;
+	auto circles = create_circles(num_balls,1234);
+
+	uint max_threads = default_thread_pool().size();
+	uint64_t reference = 0;
+	double base_ms = 0;
+	printf( "%u balls, %d steps\n%8s %12s %10s %12s\n", num_balls, steps, "threads", "ms/step", "speedup", "state" );
+	for( uint threads=1; ; threads=std::min(threads*2,max_threads) )
+	{
+		circle_world world(circles);
+		world.threads = threads;
+		world.step();	// warm up the allocations
+		double ms = bench_ms_per_step( steps, [&](){ world.step(); } );
+		uint64_t h = hash_balls(world.balls);
+		if(threads==1){ reference = h; base_ms = ms; }
+		printf( "%8u %12.3f %10.2f %12s\n", threads, ms, base_ms/ms, h==reference?"identical":"DIFFERENT" );
+		if(threads==max_threads) break;
+	}
+}
+
+//*************************************
+// collision response benchmark: "--bench-response [steps] [balls]"
+// compares the original trigonometric formula against the impulse solver
+inline double kinetic_energy( const ball_store& b, bool b_mass )
+{
+	double e = 0;
+	for( size_t k=0; k < b.size(); k++ ) e += 0.5*(b_mass?double(b.radius[k])*b.radius[k]:1.0)*(double(b.vx[k])*b.vx[k]+double(b.vy[k])*b.vy[k]);
+	return e;
+}
+
+inline void run_response_benchmark( size_t steps, uint num_balls )
+{
+	const char* names[] = { "legacy", "impulse" };
+
+	// solver alone: resolve the contacts of a dense scene over and over
+	{
+		circle_world world(create_circles(20000,1234));
+		collision_stats stats;
+		collide_grid( world.balls, world.grid, world.batches, world.response, 1, stats );	// separate the spawned overlaps
+		world.step();
+		const std::vector<contact> contacts = world.batches.sorted;
+		printf( "%zu contacts of %zu balls resolved 200 times\n%8s %16s\n", contacts.size(), world.balls.size(), "solver", "Mcontacts/s" );
+		for( int k=0; k < 2; k++ )
+		{
+			response_params params; params.b_legacy = k==0;
+			double ms = 0;
+			for( int rep=0; rep < 200; rep++ )
+			{
+				ball_store b = world.balls;
+				ms += bench_ms_per_step( 1, [&](){ for( const contact& c : contacts ) collide_pair( b, c.i, c.j, params ); } );
+			}
+			printf( "%8s %16.2f\n", names[k], contacts.size()*200/ms/1000.0 );
+		}
+	}
+
+	// energy drift over a long run; equal masses as in the original formula
+	auto circles = create_circles(num_balls,1234);
+	printf( "\n%u balls, %zu steps\n%8s %14s %14s %16s\n", num_balls, steps, "solver", "contacts", "ms", "energy drift" );
+	for( int k=0; k < 2; k++ )
+	{
+		circle_world world(circles);
+		world.threads = 1;
+		world.response.b_legacy = k==0;
+		double e0 = kinetic_energy( world.balls, false );
+		size_t contacts = 0;
+		double ms = bench_ms_per_step( 1, [&](){ for( size_t s=0; s < steps; s++ ){ world.step(); contacts += world.stats.contacts; } } );
+		double e1 = kinetic_energy( world.balls, false );
+		printf( "%8s %14zu %14.1f %15.3e\n", names[k], contacts, ms, (e1-e0)/e0 );
+	}
+}
+
+//*************************************
+// initial placement: "--bench-spawn"
+inline void run_spawn_benchmark()
+{
+	static const uint sweep[] = { 1000, 10000, 100000, 1000000 };
+	printf( "%8s %12s %10s\n", "balls", "ms", "overlaps" );
+	for( uint n : sweep )
+	{
+		auto t0 = std::chrono::high_resolution_clock::now();
+		circle_world world(create_circles(n,1234));
+		auto t1 = std::chrono::high_resolution_clock::now();
+
+		// count overlapping pairs with the grid
+		collision_stats stats;
+		world.grid.build( world.balls );
+		size_t overlaps = 0;
+		for( int r=0; r < world.grid.rows; r++ )
+		{
+			std::vector<contact> found;
+			find_contacts( world.balls, world.grid, r, r+1, found, stats.pairs );
+			overlaps += found.size();
+		}
+		printf( "%8zu %12.1f %10zu\n", world.balls.size(), std::chrono::duration<double,std::milli>(t1-t0).count(), overlaps );
+	}
+}
+
+//*************************************
+// regression check of the continuous collision pass: "--test-ccd"; returns false when a fast pair tunnels
+// two fast balls cross head-on, the higher index starting several cells outside the sweep of the lower one;
+// a lattice of resting balls away from them makes the grid cells small
+inline bool run_ccd_test()
+{
+	circle_world world;
+	circle_t c = {}; c.radius = 0.005f; c.color = vec4(1);
+	for( int k=0; k < 10000; k++ ){ c.center = vec2( -1.4f+0.014f*(k%200), 0.3f+0.014f*(k/200) ); world.balls.push_back( c ); }
+
+	// 0.1 per step each, touching at 90% of the step; the cells are 0.02 wide
+	c.radius = 0.01f;
+	c.center = vec2(-0.3f,0.0f); world.balls.push_back( c ); world.balls.vx.back() = 24.0f;
+	c.center = vec2(-0.1f,0.0f); world.balls.push_back( c ); world.balls.vx.back() = -24.0f;
+	world.b_ccd = true;
+
+	bool b_pass = true;
+	for( int grid=0; grid < 2; grid++ )
+	{
+		circle_world w = world; w.b_grid = grid==1;
+		w.step();
+		size_t i = w.balls.size()-2, j = i+1;
+		bool b_bounced = w.balls.vx[i] < 0 && w.balls.vx[j] > 0 && w.balls.x[i] < w.balls.x[j];
+		printf( "%12s: %zu impacts, x %.3f and %.3f, vx %.1f and %.1f: %s\n", grid ? "grid" : "brute-force", w.stats.impacts, w.balls.x[i], w.balls.x[j], w.balls.vx[i], w.balls.vx[j], b_bounced ? "bounced" : "TUNNELED" );
+		b_pass = b_pass && b_bounced;
+	}
+	return b_pass;
+}
+
+#endif // __BENCH_H__
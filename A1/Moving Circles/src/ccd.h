@@ -0,0 +1,128 @@
+#pragma once
+#ifndef __CCD_H__
+#define __CCD_H__
+#include "collision.h"
+#include "integrate.h"
+
+//*************************************
+// continuous collision detection for fast balls
+// only balls moving farther than half their radius in a step are swept; slower pairs cannot pass
+// through each other within a step, so the discrete pass already catches them
+enum { WALL_RIGHT=-1, WALL_LEFT=-2, WALL_TOP=-3, WALL_BOTTOM=-4 };
+
+// first impact of ball i within a step: another ball (j>=0) or a wall (j<0)
+struct impact { float t; int i, j; };
+
+struct ccd_state
+{
+	std::vector<int>		fast;		// indices of the fast balls
+	std::vector<uint8_t>	b_fast;		// is each ball fast?
+	std::vector<uint8_t>	b_hit;		// has each ball had an impact in this step?
+	std::vector<impact>		impacts;	// impacts sorted by time
+};
+
+// earliest t in [0,dt] when two swept balls touch; a negative value when they do not
+inline float time_of_impact( const ball_store& b, int i, int j, float dt )
+{
+	float px = b.x[i]-b.x[j], py = b.y[i]-b.y[j], r = b.radius[i]+b.radius[j];
+	float vx = b.vx[i]-b.vx[j], vy = b.vy[i]-b.vy[j];
+	float c = px*px+py*py-r*r;	if(c <= 0) return -1.0f;	// already touching: left to the discrete pass
+	float h = px*vx+py*vy;		if(h >= 0) return -1.0f;	// moving apart
+	float a = vx*vx+vy*vy, disc = h*h-a*c;
+	if(disc < 0) return -1.0f;
+	float t = (-h-sqrt(disc))/a;
+	return t <= dt ? t : -1.0f;
+}
+
+// earliest t in [0,dt] when a swept ball reaches a wall; a negative value when it does not
+inline float wall_time_of_impact( const ball_store& b, int i, float dt, int& wall )
+{
+	float t = -1.0f, r = b.radius[i], tx, ty;
+	if(b.vx[i] > 0)			{ tx = (ARENA_X-r-b.x[i])/b.vx[i];	if(tx >= 0 && tx <= dt){ t = tx; wall = WALL_RIGHT; } }
+	else if(b.vx[i] < 0)	{ tx = (r-ARENA_X-b.x[i])/b.vx[i];	if(tx >= 0 && tx <= dt){ t = tx; wall = WALL_LEFT; } }
+	if(b.vy[i] > 0)			{ ty = (ARENA_Y-r-b.y[i])/b.vy[i];	if(ty >= 0 && ty <= dt && (t < 0 || ty < t)){ t = ty; wall = WALL_TOP; } }
+	else if(b.vy[i] < 0)	{ ty = (r-ARENA_Y-b.y[i])/b.vy[i];	if(ty >= 0 && ty <= dt && (t < 0 || ty < t)){ t = ty; wall = WALL_BOTTOM; } }
+	return t;
+}
+
+//*************************************
+// find the impacts of the fast balls and sub-step only the affected balls
+// call after the discrete pass and right before integrate_balls(); an impacted ball is moved to the impact,
+// bounced, and moved back by t along its new velocity, so that the integration over dt ends at the right place
+// the grid is rebuilt here, since the discrete pass has moved the balls since it was built
+inline void sweep_fast_balls( ball_store& b, circle_grid& grid, bool b_grid, uint threads, ccd_state& ccd, const response_params& p, float dt, collision_stats& stats )
+{
+	int n = int(b.size());
+	ccd.fast.clear();
+	ccd.b_fast.assign( n, 0 );
+	float reach = 0.0f;	// largest displacement of a fast ball in this step
+	for( int k=0; k < n; k++ )
+	{
+		float d2 = (b.vx[k]*b.vx[k]+b.vy[k]*b.vy[k])*dt*dt;
+		if(d2 > 0.25f*b.radius[k]*b.radius[k]){ ccd.fast.push_back(k); ccd.b_fast[k] = 1; reach = max(reach,d2); }
+	}
+	if(ccd.fast.empty()) return;
+	reach = sqrt(reach);
+	if(b_grid) grid.build( b, threads );
+
+	// candidate test; pairs of two fast balls are tested once from the lower index
+	ccd.impacts.clear();
+	auto test = [&]( int i, int j )
+	{
+		if(j==i||(ccd.b_fast[j]&&j<i)) return;
+		stats.pairs++;
+		float t = time_of_impact( b, i, j, dt );
+		if(t >= 0) ccd.impacts.push_back({t,i,j});
+	};
+
+	for( int i : ccd.fast )
+	{
+		int wall = 0;
+		float t = wall_time_of_impact( b, i, dt, wall );
+		if(t >= 0) ccd.impacts.push_back({t,i,wall});
+
+		if(!b_grid){ for( int j=0; j < n; j++ ) test(i,j); continue; }
+
+		// cells under the swept ball, grown by the largest radius and the largest slow motion (half a radius),
+		// and by the largest fast motion, so that a fast ball of a higher index is found from its start
+		float x1 = b.x[i]+b.vx[i]*dt, y1 = b.y[i]+b.vy[i]*dt, margin = b.radius[i]+grid.cell_size*0.75f+reach;
+		int cx0 = grid.col(std::min(b.x[i],x1)-margin), cx1 = grid.col(std::max(b.x[i],x1)+margin);
+		int cy0 = grid.row(std::min(b.y[i],y1)-margin), cy1 = grid.row(std::max(b.y[i],y1)+margin);
+		for( int cy=cy0; cy <= cy1; cy++ ) for( int cx=cx0; cx <= cx1; cx++ )
+		{
+			int c = cy*grid.cols+cx;
+			for( int a=grid.cell_start[c]; a < grid.cell_start[c+1]; a++ ) test(i,grid.items[a]);
+		}
+	}
+
+	// earliest impacts first; a ball takes at most one impact per step to keep the pass cheap
+	std::sort( ccd.impacts.begin(), ccd.impacts.end(), []( const impact& a, const impact& b ){ return a.t<b.t||(a.t==b.t&&(a.i<b.i||(a.i==b.i&&a.j<b.j))); } );
+	ccd.b_hit.assign( n, 0 );
+	for( const impact& e : ccd.impacts )
+	{
+		int i = e.i, j = e.j;
+		if(ccd.b_hit[i]||(j>=0&&ccd.b_hit[j])) continue;
+
+		// move to the time of impact
+		b.x[i] += b.vx[i]*e.t;	b.y[i] += b.vy[i]*e.t;
+		if(j>=0){ b.x[j] += b.vx[j]*e.t;	b.y[j] += b.vy[j]*e.t; }
+
+		// bounce
+		if(j==WALL_RIGHT)			b.vx[i] = -fabsf(b.vx[i]);
+		else if(j==WALL_LEFT)		b.vx[i] = fabsf(b.vx[i]);
+		else if(j==WALL_TOP)		b.vy[i] = -fabsf(b.vy[i]);
+		else if(j==WALL_BOTTOM)		b.vy[i] = fabsf(b.vy[i]);
+		else
+		{
+			float nx = b.x[i]-b.x[j], ny = b.y[i]-b.y[j], inv_d = 1.0f/sqrt(nx*nx+ny*ny);
+			apply_impulse( b, i, j, nx*inv_d, ny*inv_d, p );
+		}
+
+		// move back along the new velocities
+		b.x[i] -= b.vx[i]*e.t;	b.y[i] -= b.vy[i]*e.t;	ccd.b_hit[i] = 1;
+		if(j>=0){ b.x[j] -= b.vx[j]*e.t;	b.y[j] -= b.vy[j]*e.t;	ccd.b_hit[j] = 1; }
+		stats.impacts++;
+	}
+}
+
+#endif // __CCD_H__
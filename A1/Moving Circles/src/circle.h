@@ -1,8 +1,11 @@
 #pragma once
 #ifndef __CIRCLE_H__
 #define __CIRCLE_H__
+#include<algorithm>
 #include<ctime>
-#include<cstdlib>
+#include<vector>
+#include "cgmath.h"
+#include "rng.h"
 #define NUM_OF_BALLS 41
 struct circle_t
 {
@@ -16,52 +19,56 @@ struct circle_t
 	void	update();
 };
 
-inline std::vector<circle_t> create_circles()
+inline std::vector<circle_t> create_circles( uint num_balls=NUM_OF_BALLS, uint seed=uint(time(nullptr)) )
 {
 	std::vector<circle_t> circles;
+	circles.reserve(num_balls);
 
-	// Setting a random seed
-	time_t current_time;
-	time(&current_time);
-	srand((unsigned int)current_time);
-	
-	int i = 0;
-	vec2 centers[NUM_OF_BALLS];
-	float radii[NUM_OF_BALLS];
-	while (i < NUM_OF_BALLS) {
-		circle_t c;
-
-		// Setting a random number among 0~1
-		float random_center_x = (float)rand() / 32767;
-		float random_center_y = (float)rand() / 32767;
-		float random_radius = 0.05f + (float)rand() / 32767 /(float) sqrt(NUM_OF_BALLS) / 2;
-		for (int j = 0; j < i; j++) {
-			if (sqrt(pow(random_center_x - centers[j].x, 2) + pow(random_center_y - centers[j].y, 2)) < random_radius + radii[j]) continue;
+	// Setting a random seed; the current time unless a fixed seed is given
+	pcg32 rng(seed);
+
+	// the minimum radius shrinks for large scenes so that the balls cover a similar area
+	float min_radius = min(0.05f, 0.5f / (float)sqrt(num_balls));
+	float max_radius = min_radius + 0.5f / (float)sqrt(num_balls);
+
+	// rejection sampling on a grid of the largest diameter: a new ball can only overlap the balls in the 3x3 cells around it
+	int cols = std::max(1, int(3.0f / (max_radius * 2))), rows = std::max(1, int(2.0f / (max_radius * 2)));
+	float cell_size = max(3.0f / cols, 2.0f / rows);
+	std::vector<int> head(cols * rows, -1);	// the last ball of each cell
+	std::vector<int> next;					// the previous ball in the same cell
+	next.reserve(num_balls);
+
+	for (uint i = 0; i < num_balls; i++) {
+		float radius = min_radius + rng.uniform() / (float)sqrt(num_balls) / 2;
+
+		// random positions inside the walls until one does not overlap
+		vec2 center;
+		bool b_placed = false;
+		for (int attempt = 0; attempt < 1024 && !b_placed; attempt++) {
+			center = vec2(rng.uniform(radius - 1.5f, 1.5f - radius), rng.uniform(radius - 1.0f, 1.0f - radius));
+			int cx = std::min(cols - 1, int((center.x + 1.5f) / cell_size)), cy = std::min(rows - 1, int((center.y + 1.0f) / cell_size));
+			b_placed = true;
+			for (int y = std::max(0, cy - 1); y <= std::min(rows - 1, cy + 1) && b_placed; y++)
+				for (int x = std::max(0, cx - 1); x <= std::min(cols - 1, cx + 1) && b_placed; x++)
+					for (int j = head[y * cols + x]; j >= 0 && b_placed; j = next[j]) {
+						float dx = center.x - circles[j].center.x, dy = center.y - circles[j].center.y, r = radius + circles[j].radius;
+						if (dx * dx + dy * dy < r * r) b_placed = false;
+					}
 		}
-		float random_theta = (float)rand() / 32767 * PI;
-		float random_color_r = (float)rand() / 32767;
-		float random_color_g = (float)rand() / 32767;
-		float random_color_b = (float)rand() / 32767;
-		float random_speed = (float)rand() / 32767;
-
-		// Randomly choose a sign
-		if (rand() % 2 == 0) random_center_x *= -1;
-		if (rand() % 2 == 0) random_center_y *= -1;
-		if (rand() % 2 == 0) random_theta *= -1;
-		
-		c = { vec2(random_center_x, random_center_y), random_radius, random_theta, vec4(random_color_r, random_color_g, random_color_b, 1.0f), random_speed };
-		circles.emplace_back(c);
+		if (!b_placed) { printf("[warning] %s(): only %u of %u balls fit in the arena\n", __func__, i, num_balls); break; }
+
+		int cell = std::min(rows - 1, int((center.y + 1.0f) / cell_size)) * cols + std::min(cols - 1, int((center.x + 1.5f) / cell_size));
+		next.push_back(head[cell]);
+		head[cell] = int(circles.size());
 
-		i++;
+		float theta = rng.uniform(-PI, PI);
+		vec4 color = vec4(rng.uniform(), rng.uniform(), rng.uniform(), 1.0f);
+		float speed = rng.uniform();
+
+		circle_t c = { center, radius, theta, color, speed };
+		circles.emplace_back(c);
 	}
 
-	/*
-	circle_t c;
-	c = { vec2(-1.0f,0.0f),0.2f,0,vec4(1.0f,0,0,1.0f),0.005f };
-	circles.emplace_back(c);
-	c = { vec2(1.0f,0.0f),0.2f,PI,vec4(0,1.0f,0,1.0f),0.005f };
-	circles.emplace_back(c);
-	*/
 	return circles;
 }
 
@@ -0,0 +1,58 @@
+#pragma once
+#ifndef __CIRCLE_WORLD_H__
+#define __CIRCLE_WORLD_H__
+#include "cgmath.h"		// no GL or GLFW dependency below this point
+#include "collision.h"
+#include "integrate.h"
+#include "ccd.h"
+#include "profiler.h"
+
+//*************************************
+// headless ball simulation advanced with a fixed time step;
+// the renderer only reads balls after advance()
+struct circle_world
+{
+	ball_store	balls;
+	float	dt = 1/240.0f;			// fixed simulation step in seconds
+	int		max_steps = 16;			// upper bound of steps per advance() to avoid the spiral of death
+	float	accumulator = 0.0f;		// elapsed time not simulated yet
+	size_t	steps = 0;				// number of simulated steps
+	bool	b_grid = true;			// use grid broadphase for collisions?
+	bool	b_ccd = false;			// sweep fast balls to find impacts within a step?
+	uint	threads = std::max(1u,std::thread::hardware_concurrency());	// tasks per parallel stage; results do not depend on it
+	response_params	response;		// restitution, masses and solver of the collision response
+	circle_grid		grid;
+	contact_batches	batches;
+	ccd_state		ccd;
+	collision_stats	stats;			// counters of the last step
+
+	circle_world( const std::vector<circle_t>& circles = {} ){ balls.reserve(circles.size()); for( auto& c : circles ) balls.push_back(c); }
+	void	step();
+	int		advance( float elapsed );
+};
+
+inline void circle_world::step()
+{
+	stats = collision_stats();
+	{
+		profile_zone zone( "collision" );
+		collide_circles( balls, b_grid, grid, batches, response, threads, stats );
+		if(b_ccd) sweep_fast_balls( balls, grid, b_grid, threads, ccd, response, dt, stats );
+	}
+
+	// move the balls and bounce them off the walls; the zones show the tasks on the worker threads
+	parallel_for( threads, balls.size(), 16384, [&]( size_t begin, size_t end ){ profile_zone zone( "integrate" ); integrate_balls( balls, dt, begin, end ); } );
+	steps++;
+}
+
+inline int circle_world::advance( float elapsed )
+{
+	// consume the elapsed wall-clock time in fixed steps, so that the result does not depend on the frame rate
+	accumulator += elapsed;
+	int n = 0;
+	for( ; accumulator >= dt && n < max_steps; n++ ){ step(); accumulator -= dt; }
+	if(n==max_steps) accumulator = 0.0f;	// drop the backlog after a long hitch
+	return n;
+}
+
+#endif // __CIRCLE_WORLD_H__
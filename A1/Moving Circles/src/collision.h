@@ -0,0 +1,273 @@
+#pragma once
+#ifndef __COLLISION_H__
+#define __COLLISION_H__
+#include <algorithm>
+#include "ball_store.h"
+#include "thread_pool.h"
+
+//*************************************
+// pair of touching balls
+struct contact { int i, j; };
+
+//*************************************
+// parameters of the collision response
+struct response_params
+{
+	float	restitution = 1.0f;		// 1: elastic, 0: perfectly inelastic
+	bool	b_mass = false;			// mass proportional to the area of the ball? otherwise equal masses
+	bool	b_legacy = false;		// use the original trigonometric formula instead of the impulse solver?
+};
+
+//*************************************
+// counters of a collision pass
+struct collision_stats
+{
+	size_t	pairs = 0;		// number of narrowphase tests
+	size_t	contacts = 0;	// number of colliding pairs
+	size_t	impacts = 0;	// number of swept impacts in the continuous mode
+};
+
+//*************************************
+// uniform grid over the [-1.5,1.5]x[-1,1] arena, rebuilt every step
+// cell size is the largest diameter, so a ball can only touch balls in the neighboring cells
+struct circle_grid
+{
+	float	cell_size = 1.0f;
+	int		cols = 1, rows = 1;
+	std::vector<int>	cell_start;	// prefix sums of the cell counts (cols*rows+1)
+	std::vector<int>	items;		// ball indices sorted by their cells
+	std::vector<int>	cell_of;	// cell index of each ball
+
+	void	build( const ball_store& balls, uint threads=1 );
+	int		col( float x ) const { int cx = int((x+1.5f)/cell_size); return cx<0 ? 0 : cx>=cols ? cols-1 : cx; }
+	int		row( float y ) const { int cy = int((y+1.0f)/cell_size); return cy<0 ? 0 : cy>=rows ? rows-1 : cy; }
+	int		cell( float x, float y ) const { return row(y)*cols+col(x); }	// clamped, since balls may leave the arena until the walls are applied
+};
+
+inline void circle_grid::build( const ball_store& balls, uint threads )
+{
+	float max_radius = 0.0f;
+	for( float r : balls.radius ) max_radius = max(max_radius,r);
+	cell_size = max(max_radius*2.0f,sqrt(6.0f/(balls.size()*4+16)));	// no more than about 4 cells per ball
+	cols = std::max(1,int(3.0f/cell_size));
+	rows = std::max(1,int(2.0f/cell_size));
+	cell_size = max(3.0f/cols,2.0f/rows);	// stretch cells to cover the arena exactly
+
+	// counting sort of the balls by their cells
+	cell_start.assign( cols*rows+1, 0 );
+	cell_of.resize( balls.size() );
+	parallel_for( threads, balls.size(), 16384, [&]( size_t begin, size_t end ){ for( size_t k=begin; k < end; k++ ) cell_of[k] = cell(balls.x[k],balls.y[k]); } );
+	for( size_t k=0; k < balls.size(); k++ ) cell_start[cell_of[k]+1]++;
+	for( size_t k=1; k < cell_start.size(); k++ ) cell_start[k] += cell_start[k-1];
+	items.resize( balls.size() );
+	std::vector<int> fill(cell_start.begin(),cell_start.end()-1);
+	for( size_t k=0; k < balls.size(); k++ ) items[fill[cell_of[k]]++] = int(k);
+}
+
+//*************************************
+// original elastic response of balls i and j in polar form; returns false when they do not touch
+inline bool collide_pair_legacy( ball_store& b, int i, int j )
+{
+	float distance = sqrt(pow(b.x[i] - b.x[j], 2) + pow(b.y[i] - b.y[j], 2));
+	float move = b.radius[i] + b.radius[j] - distance;
+
+	if (distance == 0) return false;
+	if (distance > b.radius[i] + b.radius[j]) return false;
+
+	// polar form of the velocities used by the formula below
+	float speed1 = sqrt(b.vx[i] * b.vx[i] + b.vy[i] * b.vy[i]), theta1 = atan2(b.vy[i], b.vx[i]);
+	float speed2 = sqrt(b.vx[j] * b.vx[j] + b.vy[j] * b.vy[j]), theta2 = atan2(b.vy[j], b.vx[j]);
+
+	// Collision situation
+	float phi;
+	if (b.x[i] - b.x[j] == 0) phi = PI / 2;
+	else phi = atan(abs(b.y[i] - b.y[j]) / abs(b.x[i] - b.x[j]));
+	b.vx[i] = speed2 * (float)cos(theta2 - phi) * (float)cos(phi) + speed1 * (float)sin(theta1 - phi) * (float)cos(phi + PI / 2);
+	b.vy[i] = speed2 * (float)cos(theta2 - phi) * (float)sin(phi) + speed1 * (float)sin(theta1 - phi) * (float)sin(phi + PI / 2);
+
+	b.vx[j] = speed1 * (float)cos(theta1 - phi) * (float)cos(phi) + speed2 * (float)sin(theta2 - phi) * (float)cos(phi + PI / 2);
+	b.vy[j] = speed1 * (float)cos(theta1 - phi) * (float)sin(phi) + speed2 * (float)sin(theta2 - phi) * (float)sin(phi + PI / 2);
+
+	b.x[i] += move / 2 * (b.x[i] - b.x[j]) / distance;
+	b.y[i] += move / 2 * (b.y[i] - b.y[j]) / distance;
+
+	b.x[j] -= move / 2 * (b.x[i] - b.x[j]) / distance;
+	b.y[j] -= move / 2 * (b.y[i] - b.y[j]) / distance;
+
+	return true;
+}
+
+//*************************************
+inline float inverse_mass( const ball_store& b, int k, const response_params& p )
+{
+	return p.b_mass ? 1.0f/(b.radius[k]*b.radius[k]) : 1.0f;
+}
+
+// exchange the normal impulse along the unit normal (nx,ny) from j to i, only while approaching each other
+inline void apply_impulse( ball_store& b, int i, int j, float nx, float ny, const response_params& p )
+{
+	float vn = (b.vx[i]-b.vx[j])*nx + (b.vy[i]-b.vy[j])*ny;
+	if(vn >= 0) return;
+
+	float wi = inverse_mass( b, i, p ), wj = inverse_mass( b, j, p );
+	float impulse = -(1.0f+p.restitution)*vn/(wi+wj);
+	b.vx[i] += impulse*wi*nx;	b.vy[i] += impulse*wi*ny;
+	b.vx[j] -= impulse*wj*nx;	b.vy[j] -= impulse*wj*ny;
+}
+
+// impulse response of balls i and j on cartesian velocities; returns false when they do not touch
+// one sqrt and one division per contact, no trigonometric calls
+inline bool collide_pair( ball_store& b, int i, int j, const response_params& p )
+{
+	if(p.b_legacy) return collide_pair_legacy( b, i, j );
+
+	float dx = b.x[i]-b.x[j], dy = b.y[i]-b.y[j], d2 = dx*dx+dy*dy, r = b.radius[i]+b.radius[j];
+	if(d2 == 0 || d2 > r*r) return false;
+
+	// contact normal from j to i
+	float d = sqrt(d2), inv_d = 1.0f/d;
+	float nx = dx*inv_d, ny = dy*inv_d;
+	apply_impulse( b, i, j, nx, ny, p );
+
+	// push the balls apart in proportion to their inverse masses
+	float wi = inverse_mass( b, i, p ), wj = inverse_mass( b, j, p ), w = wi+wj;
+	float push = (r-d)/w;
+	b.x[i] += push*wi*nx;	b.y[i] += push*wi*ny;
+	b.x[j] -= push*wj*nx;	b.y[j] -= push*wj*ny;
+
+	return true;
+}
+
+// reference path: every ball against every other ball; each pair is visited once, as in the grid path
+inline void collide_brute_force( ball_store& balls, const response_params& params, collision_stats& stats )
+{
+	for( int j=0; j < int(balls.size()); j++ )
+		for( int i=j+1; i < int(balls.size()); i++ )
+		{
+			stats.pairs++;
+			if(collide_pair(balls,j,i,params)) stats.contacts++;
+		}
+}
+
+//*************************************
+// contacts of the grid path grouped into batches that share no ball, so that each batch resolves in parallel
+// the batches are built and resolved in a fixed order, which makes the result independent of the thread count
+struct contact_batches
+{
+	static const int	MAX_COLORS = 64;	// contacts beyond 64 colors go to a last batch resolved serially
+	std::vector<std::vector<contact>>	found;		// contacts of each band of grid rows
+	std::vector<size_t>		tested;				// narrowphase tests of each band
+	std::vector<uint64_t>	used;				// colors already taken by each ball
+	std::vector<uint8_t>	color;				// color of each contact in the order found
+	std::vector<contact>	sorted;				// contacts sorted by color
+	int						start[MAX_COLORS+2];	// first contact of each batch
+};
+
+// narrowphase test without response
+inline bool touching( const ball_store& b, int i, int j )
+{
+	float dx = b.x[i]-b.x[j], dy = b.y[i]-b.y[j], d2 = dx*dx+dy*dy, r = b.radius[i]+b.radius[j];
+	return d2 <= r*r && d2 > 0;
+}
+
+// find the contacts of grid rows [row_begin,row_end); each pair in the same or neighboring cells is visited once
+inline void find_contacts( const ball_store& balls, const circle_grid& grid, int row_begin, int row_end, std::vector<contact>& found, size_t& tested )
+{
+	// half stencil of neighbor cells: right, lower-left, lower, lower-right
+	static const int dx[] = { 1, -1, 0, 1 }, dy[] = { 0, 1, 1, 1 };
+	for( int cy=row_begin; cy < row_end; cy++ ) for( int cx=0; cx < grid.cols; cx++ )
+	{
+		int c = cy*grid.cols+cx;
+		for( int a=grid.cell_start[c]; a < grid.cell_start[c+1]; a++ )
+		{
+			int i = grid.items[a];
+
+			// the rest of the same cell
+			for( int b=a+1; b < grid.cell_start[c+1]; b++ )
+			{
+				tested++;
+				if(touching(balls,i,grid.items[b])) found.push_back({i,grid.items[b]});
+			}
+
+			// forward neighbor cells
+			for( int k=0; k < 4; k++ )
+			{
+				int nx = cx+dx[k], ny = cy+dy[k];
+				if(nx<0||nx>=grid.cols||ny>=grid.rows) continue;
+				int n = ny*grid.cols+nx;
+				for( int b=grid.cell_start[n]; b < grid.cell_start[n+1]; b++ )
+				{
+					tested++;
+					if(touching(balls,i,grid.items[b])) found.push_back({i,grid.items[b]});
+				}
+			}
+		}
+	}
+}
+
+// broadphase path: find contacts per band of rows in parallel, color them greedily, and resolve batch by batch
+inline void collide_grid( ball_store& balls, circle_grid& grid, contact_batches& batches, const response_params& params, uint threads, collision_stats& stats )
+{
+	grid.build( balls, threads );
+
+	// contacts of bands concatenated in band order are the same for any number of bands
+	int bands = std::min( grid.rows, int(threads)*4 );
+	batches.found.resize( bands );
+	batches.tested.assign( bands, 0 );
+	parallel_for( threads, size_t(bands), 1, [&]( size_t begin, size_t end )
+	{
+		for( size_t k=begin; k < end; k++ )
+		{
+			batches.found[k].clear();
+			find_contacts( balls, grid, int(grid.rows*k/bands), int(grid.rows*(k+1)/bands), batches.found[k], batches.tested[k] );
+		}
+	});
+
+	// greedy coloring: the smallest color taken by neither ball
+	int count[contact_batches::MAX_COLORS+1] = {};
+	batches.used.assign( balls.size(), 0 );
+	batches.color.clear();
+	for( int k=0; k < bands; k++ )
+	{
+		stats.pairs += batches.tested[k];
+		for( const contact& c : batches.found[k] )
+		{
+			uint64_t taken = batches.used[c.i]|batches.used[c.j];
+			int color = 0; while( color < contact_batches::MAX_COLORS && (taken>>color&1) ) color++;
+			if(color<contact_batches::MAX_COLORS){ batches.used[c.i] |= uint64_t(1)<<color; batches.used[c.j] |= uint64_t(1)<<color; }
+			batches.color.push_back( uint8_t(color) );
+			count[color]++;
+		}
+	}
+
+	// stable counting sort of the contacts by colors
+	batches.start[0] = 0;
+	for( int k=0; k <= contact_batches::MAX_COLORS; k++ ) batches.start[k+1] = batches.start[k]+count[k];
+	batches.sorted.resize( batches.color.size() );
+	int fill[contact_batches::MAX_COLORS+1];
+	std::copy( batches.start, batches.start+contact_batches::MAX_COLORS+1, fill );
+	size_t n = 0;
+	for( int k=0; k < bands; k++ ) for( const contact& c : batches.found[k] ) batches.sorted[fill[batches.color[n++]]++] = c;
+
+	// resolve the batches in color order; a ball appears at most once in each batch except the last one
+	for( int k=0; k <= contact_batches::MAX_COLORS; k++ )
+	{
+		size_t begin = batches.start[k], size = batches.start[k+1]-begin;
+		std::atomic<size_t> resolved{0};
+		parallel_for( k<contact_batches::MAX_COLORS ? threads : 1, size, 1024, [&]( size_t b, size_t e )
+		{
+			size_t local = 0;
+			for( size_t m=begin+b; m < begin+e; m++ ) if(collide_pair(balls,batches.sorted[m].i,batches.sorted[m].j,params)) local++;
+			resolved += local;
+		});
+		stats.contacts += resolved;
+	}
+}
+
+inline void collide_circles( ball_store& balls, bool b_grid, circle_grid& grid, contact_batches& batches, const response_params& params, uint threads, collision_stats& stats )
+{
+	if(b_grid)	collide_grid( balls, grid, batches, params, threads, stats );
+	else		collide_brute_force( balls, params, stats );
+}
+
+#endif // __COLLISION_H__
@@ -0,0 +1,198 @@
+#pragma once
+#ifndef __HEADLESS_H__
+#define __HEADLESS_H__
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include "cgmath.h"
+#include "cgut.h"		// glad, GLFW
+
+// context without a window or display: EGL surfaceless (-DCG_EGL -lEGL) or OSMesa (-DCG_OSMESA -lOSMesa);
+// otherwise a hidden GLFW window, which still needs a display (e.g., xvfb-run)
+#if defined(CG_EGL)
+	#include <EGL/egl.h>
+	#include <EGL/eglext.h>
+	#ifndef EGL_PLATFORM_SURFACELESS_MESA
+		#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+	#endif
+#elif defined(CG_OSMESA)
+	#include <GL/osmesa.h>
+#endif
+
+//*************************************
+// wall-clock seconds from the first call; unlike glfwGetTime(), valid without glfwInit()
+inline double app_time()
+{
+	static const auto t0 = std::chrono::steady_clock::now();
+	return std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count();
+}
+
+//*************************************
+// offscreen rendering into a framebuffer object for a fixed number of frames or seconds
+// "--headless [frames]" enables it; "--seconds S", "--size WxH", and "--output file.ppm" refine it
+struct headless_t
+{
+	bool		b_enabled = false;
+	bool		b_software = false;	// no context at all; the program renders on the CPU ("--software")
+	int			frames = 300;		// frames to render; ignored when seconds > 0
+	double		seconds = 0.0;		// duration to render
+	ivec2		size = ivec2(1280,720);
+	const char*	output = nullptr;	// last frame as a binary PPM
+	GLuint		fbo = 0, color = 0, depth = 0;
+	std::vector<double>	frame_times;	// seconds of each frame until glFinish() returns
+	double		t0 = 0.0, t_frame = 0.0;
+#if defined(CG_EGL)
+	EGLDisplay	display = EGL_NO_DISPLAY;
+	EGLContext	context = EGL_NO_CONTEXT;
+#elif defined(CG_OSMESA)
+	OSMesaContext	context = nullptr;
+	std::vector<unsigned char>	buffer;	// default framebuffer of OSMesa; rendering still goes to the FBO
+#endif
+
+	void	parse( int argc, char* argv[] );
+	bool	create( const char* name, GLFWwindow*& window );
+	void	start();
+	bool	running( int frame );
+	void	end_frame();
+	void	finish( const unsigned char* rgb=nullptr );
+};
+
+inline void headless_t::parse( int argc, char* argv[] )
+{
+	for( int k=1; k < argc; k++ )
+	{
+		if(strcmp(argv[k],"--headless")==0){ b_enabled = true; if(k+1<argc&&argv[k+1][0]!='-') frames = std::max(1,atoi(argv[++k])); }
+		else if(strcmp(argv[k],"--seconds")==0&&k+1<argc) seconds = atof(argv[++k]);
+		else if(strcmp(argv[k],"--size")==0&&k+1<argc){ int w, h; if(sscanf(argv[++k],"%dx%d",&w,&h)==2&&w>0&&h>0) size = ivec2(w,h); }
+		else if(strcmp(argv[k],"--output")==0&&k+1<argc) output = argv[++k];
+	}
+}
+
+// creates the context and an FBO of the given size, bound for the rest of the run; window stays null without GLFW
+// with b_software, only the timing starts
+inline bool headless_t::create( const char* name, GLFWwindow*& window )
+{
+	window = nullptr;
+	if(b_software)
+	{
+		printf( "> %s headless at %dx%d without OpenGL\n", name, size.x, size.y );
+		if(seconds>0) printf( "> rendering for %g seconds\n", seconds ); else printf( "> rendering %d frames\n", frames );
+		frame_times.reserve( seconds>0 ? 4096 : frames );
+		return true;
+	}
+#if defined(CG_EGL)
+	auto get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress( "eglGetPlatformDisplayEXT" );
+	if(get_platform_display) display = get_platform_display( EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr );
+	if(display==EGL_NO_DISPLAY) display = eglGetDisplay( EGL_DEFAULT_DISPLAY );
+	EGLint major, minor, count; EGLConfig config;
+	static const EGLint config_attribs[] = { EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+	static const EGLint context_attribs[] = { EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 3, EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, EGL_NONE };
+	if(display==EGL_NO_DISPLAY||!eglInitialize(display,&major,&minor)){ printf( "%s(): failed to initialize EGL\n", __func__ ); return false; }
+	if(!eglBindAPI(EGL_OPENGL_API)||!eglChooseConfig(display,config_attribs,&config,1,&count)||count<1){ printf( "%s(): no EGL config for OpenGL\n", __func__ ); return false; }
+	if((context=eglCreateContext(display,config,EGL_NO_CONTEXT,context_attribs))==EGL_NO_CONTEXT){ printf( "%s(): failed to create an OpenGL 3.3 context\n", __func__ ); return false; }
+	if(!eglMakeCurrent(display,EGL_NO_SURFACE,EGL_NO_SURFACE,context)){ printf( "%s(): surfaceless contexts are not supported\n", __func__ ); return false; }
+	if(!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)){ printf( "%s(): failed to load OpenGL\n", __func__ ); return false; }
+#elif defined(CG_OSMESA)
+	static const int attribs[] = { OSMESA_FORMAT, OSMESA_RGBA, OSMESA_DEPTH_BITS, 24, OSMESA_PROFILE, OSMESA_CORE_PROFILE, OSMESA_CONTEXT_MAJOR_VERSION, 3, OSMESA_CONTEXT_MINOR_VERSION, 3, 0 };
+	if(!(context=OSMesaCreateContextAttribs(attribs,nullptr))){ printf( "%s(): failed to create an OpenGL 3.3 context\n", __func__ ); return false; }
+	buffer.resize( size_t(size.x)*size.y*4 );
+	if(!OSMesaMakeCurrent(context,buffer.data(),GL_UNSIGNED_BYTE,size.x,size.y)){ printf( "%s(): failed to make the context current\n", __func__ ); return false; }
+	if(!gladLoadGLLoader((GLADloadproc)OSMesaGetProcAddress)){ printf( "%s(): failed to load OpenGL\n", __func__ ); return false; }
+#else
+	if(!glfwInit()){ printf( "%s(): failed in glfwInit()\n", __func__ ); return false; }
+	glfwWindowHint( GLFW_VISIBLE, GLFW_FALSE );
+	glfwWindowHint( GLFW_CONTEXT_VERSION_MAJOR, 3 );
+	glfwWindowHint( GLFW_CONTEXT_VERSION_MINOR, 3 );
+	glfwWindowHint( GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE );
+	glfwWindowHint( GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE );
+	if(!(window=glfwCreateWindow(size.x,size.y,name,nullptr,nullptr))){ printf( "%s(): failed to create a hidden window\n", __func__ ); return false; }
+	glfwMakeContextCurrent( window );
+	glfwSwapInterval( 0 );
+	if(!cg_init_extensions(window)) return false;
+#endif
+
+	// color and depth renderbuffers; nothing is presented, so the default framebuffer is never used
+	glGenRenderbuffers( 1, &color );
+	glBindRenderbuffer( GL_RENDERBUFFER, color );
+	glRenderbufferStorage( GL_RENDERBUFFER, GL_RGBA8, size.x, size.y );
+	glGenRenderbuffers( 1, &depth );
+	glBindRenderbuffer( GL_RENDERBUFFER, depth );
+	glRenderbufferStorage( GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, size.x, size.y );
+	glGenFramebuffers( 1, &fbo );
+	glBindFramebuffer( GL_FRAMEBUFFER, fbo );
+	glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color );
+	glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth );
+	if(glCheckFramebufferStatus(GL_FRAMEBUFFER)!=GL_FRAMEBUFFER_COMPLETE){ printf( "%s(): incomplete framebuffer\n", __func__ ); return false; }
+	glViewport( 0, 0, size.x, size.y );
+
+	printf( "> %s headless at %dx%d: %s, OpenGL %s\n", name, size.x, size.y, (const char*) glGetString(GL_RENDERER), (const char*) glGetString(GL_VERSION) );
+	if(seconds>0) printf( "> rendering for %g seconds\n", seconds ); else printf( "> rendering %d frames\n", frames );
+	frame_times.reserve( seconds>0 ? 4096 : frames );
+	return true;
+}
+
+// starts the clock of --seconds and of the first frame; called right before the render loop,
+// so that shader compilation and scene setup count toward neither
+inline void headless_t::start()
+{
+	t0 = t_frame = app_time();
+}
+
+inline bool headless_t::running( int frame )
+{
+	return seconds>0 ? app_time()-t0 < seconds : frame < frames;
+}
+
+// waits for the GPU, so that each frame time includes its rendering, not only the submission
+inline void headless_t::end_frame()
+{
+	if(!b_software) glFinish();
+	double t = app_time();
+	frame_times.push_back( t-t_frame );
+	t_frame = t;
+}
+
+// prints the frame statistics, writes the last frame, and releases the context
+// rgb replaces glReadPixels() as the last frame: size.x*size.y pixels with the rows bottom-up
+inline void headless_t::finish( const unsigned char* rgb )
+{
+	if(!b_enabled) return;
+	if(!frame_times.empty())
+	{
+		double total = 0; for( double t : frame_times ) total += t;
+		auto r = std::minmax_element( frame_times.begin(), frame_times.end() );
+		printf( "> %d frames in %.3f s: %.3f ms/frame (min %.3f, max %.3f), %.1f fps\n", int(frame_times.size()), total, total*1000/frame_times.size(), *r.first*1000, *r.second*1000, frame_times.size()/total );
+	}
+
+	if(output)
+	{
+		std::vector<unsigned char> pixels( rgb ? 0 : size_t(size.x)*size.y*3 );
+		if(!rgb){ glPixelStorei( GL_PACK_ALIGNMENT, 1 ); glReadPixels( 0, 0, size.x, size.y, GL_RGB, GL_UNSIGNED_BYTE, pixels.data() ); rgb = pixels.data(); }
+		FILE* fp = fopen( output, "wb" );
+		if(!fp) printf( "%s(): unable to open %s\n", __func__, output );
+		else
+		{
+			fprintf( fp, "P6\n%d %d\n255\n", size.x, size.y );
+			for( int y=size.y-1; y >= 0; y-- ) fwrite( rgb+size_t(y)*size.x*3, 1, size_t(size.x)*3, fp );	// GL rows are bottom-up
+			fclose( fp );
+			printf( "> last frame written to %s\n", output );
+		}
+	}
+
+	if(b_software) return;
+	glDeleteFramebuffers( 1, &fbo );
+	glDeleteRenderbuffers( 1, &color );
+	glDeleteRenderbuffers( 1, &depth );
+#if defined(CG_EGL)
+	eglMakeCurrent( display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT );
+	eglDestroyContext( display, context );
+	eglTerminate( display );
+#elif defined(CG_OSMESA)
+	OSMesaDestroyContext( context );
+#endif
+}
+
+#endif // __HEADLESS_H__
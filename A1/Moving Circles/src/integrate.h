@@ -0,0 +1,99 @@
+#pragma once
+#ifndef __INTEGRATE_H__
+#define __INTEGRATE_H__
+#include "ball_store.h"
+
+// AVX2 when the compiler targets it (e.g., -mavx2 or /arch:AVX2), SSE2 on any x64, otherwise scalar only
+#if defined(__AVX2__)
+	#include <immintrin.h>
+#elif defined(__SSE2__)||defined(_M_X64)||(defined(_M_IX86_FP)&&_M_IX86_FP>=2)
+	#include <emmintrin.h>
+	#define CG_SSE2
+#endif
+
+// half extents of the arena
+static const float ARENA_X = 1.5f;
+static const float ARENA_Y = 1.0f;
+
+//*************************************
+// scalar kernel: move [begin,end) by dt and bounce them off the walls
+inline void integrate_balls_scalar( ball_store& b, float dt, size_t begin, size_t end )
+{
+	for( size_t k=begin; k < end; k++ )
+	{
+		float r = b.radius[k];
+		float x = b.x[k] + b.vx[k]*dt;
+		float y = b.y[k] + b.vy[k]*dt;
+
+		// clamp to the walls and point the velocity back into the arena
+		if( x >= ARENA_X-r ){ x = ARENA_X-r; b.vx[k] = -fabsf(b.vx[k]); }
+		else if( x <= r-ARENA_X ){ x = r-ARENA_X; b.vx[k] = fabsf(b.vx[k]); }
+		if( y >= ARENA_Y-r ){ y = ARENA_Y-r; b.vy[k] = -fabsf(b.vy[k]); }
+		else if( y <= r-ARENA_Y ){ y = r-ARENA_Y; b.vy[k] = fabsf(b.vy[k]); }
+
+		b.x[k] = x;
+		b.y[k] = y;
+	}
+}
+
+//*************************************
+// vectorized kernel over [begin,end); the remainder goes to the scalar kernel
+inline void integrate_balls( ball_store& b, float dt, size_t begin, size_t end )
+{
+	size_t k = begin;
+#if defined(__AVX2__)
+	const __m256 vdt = _mm256_set1_ps(dt), sign = _mm256_set1_ps(-0.0f);
+	const __m256 ax = _mm256_set1_ps(ARENA_X), ay = _mm256_set1_ps(ARENA_Y);
+	for( ; k+8 <= end; k+=8 )
+	{
+		__m256 r = _mm256_loadu_ps(&b.radius[k]);
+		__m256 vx = _mm256_loadu_ps(&b.vx[k]), vy = _mm256_loadu_ps(&b.vy[k]);
+		__m256 x = _mm256_add_ps(_mm256_loadu_ps(&b.x[k]),_mm256_mul_ps(vx,vdt));
+		__m256 y = _mm256_add_ps(_mm256_loadu_ps(&b.y[k]),_mm256_mul_ps(vy,vdt));
+
+		__m256 hx = _mm256_sub_ps(ax,r), lx = _mm256_sub_ps(r,ax);
+		__m256 hy = _mm256_sub_ps(ay,r), ly = _mm256_sub_ps(r,ay);
+		__m256 mhx = _mm256_cmp_ps(x,hx,_CMP_GE_OQ), mlx = _mm256_cmp_ps(x,lx,_CMP_LE_OQ);
+		__m256 mhy = _mm256_cmp_ps(y,hy,_CMP_GE_OQ), mly = _mm256_cmp_ps(y,ly,_CMP_LE_OQ);
+
+		// -|v| at the upper walls, +|v| at the lower walls
+		vx = _mm256_blendv_ps(_mm256_blendv_ps(vx,_mm256_andnot_ps(sign,vx),mlx),_mm256_or_ps(vx,sign),mhx);
+		vy = _mm256_blendv_ps(_mm256_blendv_ps(vy,_mm256_andnot_ps(sign,vy),mly),_mm256_or_ps(vy,sign),mhy);
+
+		_mm256_storeu_ps(&b.x[k],_mm256_min_ps(_mm256_max_ps(x,lx),hx));
+		_mm256_storeu_ps(&b.y[k],_mm256_min_ps(_mm256_max_ps(y,ly),hy));
+		_mm256_storeu_ps(&b.vx[k],vx);
+		_mm256_storeu_ps(&b.vy[k],vy);
+	}
+#elif defined(CG_SSE2)
+	const __m128 vdt = _mm_set1_ps(dt), sign = _mm_set1_ps(-0.0f);
+	const __m128 ax = _mm_set1_ps(ARENA_X), ay = _mm_set1_ps(ARENA_Y);
+	auto blend = []( __m128 a, __m128 b, __m128 m ){ return _mm_or_ps(_mm_and_ps(m,b),_mm_andnot_ps(m,a)); };
+	for( ; k+4 <= end; k+=4 )
+	{
+		__m128 r = _mm_loadu_ps(&b.radius[k]);
+		__m128 vx = _mm_loadu_ps(&b.vx[k]), vy = _mm_loadu_ps(&b.vy[k]);
+		__m128 x = _mm_add_ps(_mm_loadu_ps(&b.x[k]),_mm_mul_ps(vx,vdt));
+		__m128 y = _mm_add_ps(_mm_loadu_ps(&b.y[k]),_mm_mul_ps(vy,vdt));
+
+		__m128 hx = _mm_sub_ps(ax,r), lx = _mm_sub_ps(r,ax);
+		__m128 hy = _mm_sub_ps(ay,r), ly = _mm_sub_ps(r,ay);
+		__m128 mhx = _mm_cmpge_ps(x,hx), mlx = _mm_cmple_ps(x,lx);
+		__m128 mhy = _mm_cmpge_ps(y,hy), mly = _mm_cmple_ps(y,ly);
+
+		// -|v| at the upper walls, +|v| at the lower walls
+		vx = blend(blend(vx,_mm_andnot_ps(sign,vx),mlx),_mm_or_ps(vx,sign),mhx);
+		vy = blend(blend(vy,_mm_andnot_ps(sign,vy),mly),_mm_or_ps(vy,sign),mhy);
+
+		_mm_storeu_ps(&b.x[k],_mm_min_ps(_mm_max_ps(x,lx),hx));
+		_mm_storeu_ps(&b.y[k],_mm_min_ps(_mm_max_ps(y,ly),hy));
+		_mm_storeu_ps(&b.vx[k],vx);
+		_mm_storeu_ps(&b.vy[k],vy);
+	}
+#endif
+	integrate_balls_scalar( b, dt, k, end );
+}
+
+inline void integrate_balls( ball_store& b, float dt ){ integrate_balls( b, dt, 0, b.size() ); }
+
+#endif // __INTEGRATE_H__
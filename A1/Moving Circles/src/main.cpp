@@ -1,6 +1,15 @@
 #include "cgmath.h"		// slee's simple math library
 #include "cgut.h"		// slee's OpenGL utility
 #include "circle.h"		// circle class definition
+#include "circle_world.h"	// headless ball simulation
+#include "bench.h"		// headless benchmark
+#include "uniforms.h"	// cached uniform locations and values
+#include "frustum.h"	// view-frustum culling
+#include "vertex_format.h"	// compact vertex layouts
+#include "headless.h"	// offscreen rendering without a window
+#include "gpu_timer.h"	// CPU and GPU frame profiler
+#include "replay.h"		// input recording and replay
+#include "soft_raster.h"	// tile-based software rasterizer
 
 //*************************************
 // global constants
@@ -16,11 +25,24 @@ static const uint TESS = 64;
 // window objects
 GLFWwindow*	window = nullptr;
 ivec2		window_size = ivec2(720, 480);
+headless_t	headless;	// offscreen rendering for a fixed number of frames or seconds
+soft_rasterizer	raster;	// "--software" renders headless on the CPU instead of OpenGL
 
 //*************************************
 // OpenGL objects
 GLuint	program = 0;		// ID holder for GPU program
 GLuint	vertex_array = 0;	// ID holder for vertex array object
+GLuint	instance_buffer = 0;	// ID holder for per-instance circle buffer
+program_uniforms	uniforms;	// active uniforms of the program
+
+// typed handles of the uniforms, resolved once after linking
+struct
+{
+	uniform<int>	b_solid_color, b_instanced, b_impostor;
+	uniform<mat4>	aspect_matrix, model_matrix;
+	uniform<vec4>	solid_color;
+	uniform<uint>	vertex_format;
+} u;
 
 //*************************************
 // global variables
@@ -29,115 +51,172 @@ float	t1 = 0.0f;						// previous simulation parameter
 float	t2 = 0.0f;						// current simulation parameter
 bool	b_solid_color = true;			// use circle's color?
 bool	b_index_buffer = true;			// use index buffering?
+bool	b_instanced = true;				// draw all circles with a single instanced call?
+bool	b_impostor = false;				// draw instanced quads cut out to discs instead of the circle mesh?
+bool	b_stats = false;				// print draw calls and CPU frame time every second?
+bool	b_culling = true;				// skip the balls outside the window?
+vertex_format	vformat = VERTEX_FLOAT;	// layout of the circle vertex buffer
+mat4	aspect_matrix;					// tricky aspect correction matrix for non-square window
 #ifndef GL_ES_VERSION_2_0
 bool	b_wireframe = false;
 #endif
-auto	circles = std::move(create_circles());
+uint			seed = uint(time(nullptr));	// random seed of the balls; fixed with --seed for reproducible runs
+circle_world	world;						// ball simulation; rendering only reads from it
 struct { bool add=false, sub=false; operator bool() const { return add||sub; } } b; // flags of keys for smooth changes
 
 //*************************************
 // holder of vertices and indices of a unit circle
 std::vector<vertex>	unit_circle_vertices;	// host-side vertices
+std::vector<uint>	unit_circle_indices;	// host-side indices of the triangle fan
+
+//*************************************
+// per-instance data streamed to circ.vert every frame
+struct circle_instance
+{
+	vec3	circle;		// center.xy and radius
+	vec4	color;		// RGBA color
+};
+std::vector<circle_instance> instances;
+std::vector<uint>	visible;		// indices of the balls inside the view
+
+// accumulated draw calls and CPU frame time for the stats output
+struct { int frames=0, draw_calls=0, gl_calls=0, skipped=0, visible=0, culled=0; double cpu_time=0, t0=0; } perf;
 
 //*************************************
 void update()
 {
-	// Update current time
-	t2 = float(glfwGetTime());
+	// Update current time and advance the simulation in fixed steps
+	t2 = float(replay().clock(app_time()));	// fixed steps of a virtual clock when recording or replaying
+	{ profile_zone zone( "simulation" ); world.advance( t2 - t1 ); }
+	t1 = t2;
 
 	// tricky aspect correction matrix for non-square window
-	float aspect = window_size.x/float(window_size.y);
-	mat4 aspect_matrix = 
 	{
-		min(1/aspect,1.0f), 0, 0, 0,
-		0, min(aspect,1.0f), 0, 0,
+		profile_zone zone( "matrices" );
+		float aspect = window_size.x/float(window_size.y);
+		aspect_matrix = 
+		{
+			min(1/aspect,1.0f), 0, 0, 0,
+			0, min(aspect,1.0f), 0, 0,
+			0, 0, 1, 0,
+			0, 0, 0, 1
+		};
+	}
+
+	// update common uniform variables in vertex/fragment shaders
+	if(raster.b_enabled) return;
+	profile_zone zone( "uniforms" );
+	uniforms.set( u.b_solid_color, int(b_solid_color) );
+	uniforms.set( u.aspect_matrix, aspect_matrix );
+}
+
+// scale by the radius and translate to the center
+mat4 circle_model_matrix( const ball_store& balls, uint k )
+{
+	float r = balls.radius[k];
+	return
+	{
+		r, 0, 0, balls.x[k],
+		0, r, 0, balls.y[k],
 		0, 0, 1, 0,
 		0, 0, 0, 1
 	};
-
-	// update common uniform variables in vertex/fragment shaders
-	GLint uloc;
-	uloc = glGetUniformLocation( program, "b_solid_color" );	if(uloc>-1) glUniform1i( uloc, b_solid_color );
-	uloc = glGetUniformLocation( program, "aspect_matrix" );	if(uloc>-1) glUniformMatrix4fv( uloc, 1, GL_TRUE, aspect_matrix );
 }
 
 void render()
 {
-	// clear screen (with background color) and clear depth buffer
-	glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+	// clear screen (with background color) and clear depth buffer; the software rasterizer clears each tile before drawing it
+	if(raster.b_enabled) raster.begin_frame();
+	else
+	{
+		glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
 
-	// notify GL that we use our own program
-	glUseProgram( program );
+		// notify GL that we use our own program
+		glUseProgram( program );
 
-	// bind vertex array object
-	glBindVertexArray( vertex_array );
+		// bind vertex array object
+		glBindVertexArray( vertex_array );
+		gl_count(3);
+	}
 
-	// To consider a collision, send the next location and the radius of the balls in the next frame to circle_t::update()
-	for (int j = 0; j < NUM_OF_BALLS; j++) {
-		circles.at(j).center.x = circles.at(j).center.x + circles.at(j).speed * cos(circles.at(j).theta) * (t2 - t1) * 3;
-		circles.at(j).center.y = circles.at(j).center.y + circles.at(j).speed * sin(circles.at(j).theta) * (t2 - t1) * 3;
+	double t_begin = app_time();
+	int draw_calls = 0;
+	if(!raster.b_enabled)
+	{
+		uniforms.set(u.b_instanced, int(b_instanced||b_impostor));
+		uniforms.set(u.b_impostor, int(b_impostor));
+		uniforms.set(u.vertex_format, uint(vformat));
 	}
 
-	// Update previous time
-	t1 = t2;
+	// balls inside the clip volume of the aspect matrix; a narrow window shows only part of the arena
+	const ball_store& balls = world.balls;
+	{
+		profile_zone zone("culling");
+		if (b_culling) cull_spheres(make_frustum(aspect_matrix), balls.x.data(), balls.y.data(), nullptr, balls.radius.data(), balls.size(), visible);
+		else { visible.resize(balls.size()); for (size_t k = 0; k < visible.size(); k++) visible[k] = uint(k); }
+	}
+
+	// the software rasterizer draws the circle mesh of each ball in every mode, since instancing and impostors are shaders
+	if (raster.b_enabled) {
+		{
+			profile_zone zone("draw");
+			for (uint k : visible) {
+				raster.draw(aspect_matrix * circle_model_matrix(balls, k), unit_circle_vertices.data(), unit_circle_indices.data(), TESS * 3, b_solid_color ? &balls.color[k] : nullptr);
+				draw_calls++;
+			}
+		}
+		profile_zone zone("raster");
+		raster.end_frame();
+	}
 
-	for (int j = 0; j < NUM_OF_BALLS; j++) {
-		
-		for (int i = 0; i < NUM_OF_BALLS; i++) {
-			float distance = sqrt(pow(circles.at(j).center.x - circles.at(i).center.x, 2) + pow(circles.at(j).center.y - circles.at(i).center.y, 2));
-			float move = circles.at(j).radius + circles.at(i).radius - distance;
-
-			if (distance == 0) continue;
-			if (distance <= circles.at(j).radius + circles.at(i).radius ) { // Collision situation
-				float phi;
-				if (circles.at(j).center.x - circles.at(i).center.x == 0) phi = PI / 2;
-				else phi = atan(abs(circles.at(j).center.y - circles.at(i).center.y) / abs(circles.at(j).center.x - circles.at(i).center.x));
-				float v1x = circles.at(i).speed * (float)cos(circles.at(i).theta - phi) * (float)cos(phi) + circles.at(j).speed * (float)sin(circles.at(j).theta - phi) * (float)cos(phi + PI / 2);
-				float v1y = circles.at(i).speed * (float)cos(circles.at(i).theta - phi) * (float)sin(phi) + circles.at(j).speed * (float)sin(circles.at(j).theta - phi) * (float)sin(phi + PI / 2);
-				
-				float v2x = circles.at(j).speed * (float)cos(circles.at(j).theta - phi) * (float)cos(phi) + circles.at(i).speed * (float)sin(circles.at(i).theta - phi) * (float)cos(phi + PI / 2);
-				float v2y = circles.at(j).speed * (float)cos(circles.at(j).theta - phi) * (float)sin(phi) + circles.at(i).speed * (float)sin(circles.at(i).theta - phi) * (float)sin(phi + PI / 2);
-				
-				
-				circles.at(j).speed = sqrt(pow(v1x, 2) + pow(v1y, 2));  // Sum of component vectors
-				if (v1y >= 0) {
-					circles.at(j).theta = acos(v1x / circles.at(j).speed);  // Inner product with (1,0)
-				}
-				else {
-					circles.at(j).theta = -acos(v1x / circles.at(j).speed); // Can't use +arccos!! It returns a value less than PI so that balls tend to go up
-				}
-				
-				circles.at(i).speed = sqrt(pow(v2x, 2) + pow(v2y, 2));
-				if (v2y >= 0) {
-					circles.at(i).theta = acos(v2x / circles.at(i).speed);  // Inner product with (1,0)
-				}
-				else {
-					circles.at(i).theta = -acos(v2x / circles.at(i).speed);
-				}
-
-				circles.at(j).center.x += move / 2 * (circles.at(j).center.x - circles.at(i).center.x) / distance;
-				circles.at(j).center.y += move / 2 * (circles.at(j).center.y - circles.at(i).center.y) / distance;
-
-				circles.at(i).center.x -= move / 2 * (circles.at(j).center.x - circles.at(i).center.x) / distance;
-				circles.at(i).center.y -= move / 2 * (circles.at(j).center.y - circles.at(i).center.y) / distance;
+	// the draw calls, with the time the GPU takes for them
+	else {
+		gpu_zone zone("draw");
+		if (b_instanced||b_impostor) {
+			// stream center, radius and color of every visible circle into the instance buffer
+			instances.resize(visible.size());
+			for (size_t v = 0; v < instances.size(); v++) {
+				uint k = visible[v];
+				instances[v] = { vec3(balls.x[k], balls.y[k], balls.radius[k]), balls.color[k] };
+			}
+			glBindBuffer(GL_ARRAY_BUFFER, instance_buffer);
+			glBufferData(GL_ARRAY_BUFFER, sizeof(circle_instance) * std::max<size_t>(1, instances.size()), nullptr, GL_STREAM_DRAW);	// orphan the storage of the last frame; never empty
+			glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(circle_instance) * instances.size(), instances.data());
+			gl_count(3);
+
+			// a single draw call for all circles; impostors are quads of four vertices
+			if (b_impostor)		glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, GLsizei(instances.size()));
+			else if (b_index_buffer)	glDrawElementsInstanced(GL_TRIANGLES, TESS * 3, GL_UNSIGNED_INT, nullptr, GLsizei(instances.size()));
+			else				glDrawArraysInstanced(GL_TRIANGLES, 0, TESS * 3, GLsizei(instances.size()));
+			draw_calls++; gl_count();
+		}
+		else {
+			for (uint k : visible) {
+				// update per-circle uniforms
+				uniforms.set(u.solid_color, balls.color[k]);
+				uniforms.set(u.model_matrix, circle_model_matrix(balls, k));
+
+				// per-circle draw calls
+				if (b_index_buffer)	glDrawElements(GL_TRIANGLES, TESS * 3, GL_UNSIGNED_INT, nullptr);
+				else				glDrawArrays(GL_TRIANGLES, 0, TESS * 3); // TESS = N
+				draw_calls++; gl_count();
 			}
 		}
-		// per-circle update
-		//c.update(t);
-		circles.at(j).update();
-
-		// update per-circle uniforms
-		GLint uloc;
-		uloc = glGetUniformLocation(program, "solid_color");		if (uloc > -1) glUniform4fv(uloc, 1, circles.at(j).color);	// pointer version
-		uloc = glGetUniformLocation(program, "model_matrix");		if (uloc > -1) glUniformMatrix4fv(uloc, 1, GL_TRUE, circles.at(j).model_matrix);
-
-		// per-circle draw calls
-		if (b_index_buffer)	glDrawElements(GL_TRIANGLES, TESS * 3, GL_UNSIGNED_INT, nullptr);
-		else				glDrawArrays(GL_TRIANGLES, 0, TESS * 3); // TESS = N
 	}
 
-	// swap front and back buffers, and display to screen
-	glfwSwapBuffers( window );
+	// CPU time of issuing the frame, excluding the swap
+	double t_end = app_time();
+	perf.frames++; perf.draw_calls += draw_calls; perf.cpu_time += t_end - t_begin;
+	perf.gl_calls += gl_calls().total(); perf.skipped += gl_calls().skipped; gl_calls() = {};
+	perf.visible += int(visible.size()); perf.culled += int(balls.size() - visible.size());
+	if (t_end - perf.t0 >= 1.0) {
+		if (b_stats) printf("> %s: %d draw calls/frame, %d GL calls/frame (%d uploads skipped), %d visible, %d culled, %.3f ms CPU/frame\n", raster.b_enabled ? "software" : b_impostor ? "impostor" : b_instanced ? "instanced" : "per-circle", perf.draw_calls / perf.frames, perf.gl_calls / perf.frames, perf.skipped / perf.frames, perf.visible / perf.frames, perf.culled / perf.frames, perf.cpu_time * 1000.0 / perf.frames);
+		perf = {}; perf.t0 = t_end;
+	}
+
+	// swap front and back buffers, and display to screen; the headless FBO is never presented
+	profile_zone zone("swap");
+	if (!headless.b_enabled) glfwSwapBuffers( window );
 }
 
 void reshape( GLFWwindow* window, int width, int height )
@@ -154,6 +233,14 @@ void print_help()
 	printf( "- press ESC or 'q' to terminate the program\n" );
 	printf( "- press F1 or 'h' to see help\n" );
 	printf( "- press 'i' to toggle between index buffering and simple vertex buffering\n" );
+	printf( "- press 'g' to toggle between grid broadphase and brute-force collisions\n" );
+	printf( "- press 'c' to toggle continuous collision detection of fast balls\n" );
+	printf( "- press 'n' to toggle between instanced and per-circle drawing\n" );
+	printf( "- press 'o' to toggle instanced disc impostors against the circle mesh\n" );
+	printf( "- press 'v' to cycle float > octahedral > 10:10:10:2 > position-only vertices\n" );
+	printf( "- press 'f' to toggle culling of the balls outside the window\n" );
+	printf( "- press 'p' to toggle printing draw calls, GL calls, culled balls and CPU frame time\n" );
+	printf( "- press 'u' to toggle between cached and per-draw uniform lookups\n" );
 #ifndef GL_ES_VERSION_2_0
 	printf( "- press 'w' to toggle wireframe\n" );
 #endif
@@ -171,10 +258,23 @@ std::vector<vertex> create_circle_vertices( uint N )
 	return v;
 }
 
+std::vector<uint> create_circle_indices( uint N )
+{
+	std::vector<uint> indices;
+	for( uint k=0; k < N; k++ )
+	{
+		indices.push_back(0);	// the origin
+		indices.push_back(k+1);
+		indices.push_back(k+2);
+	}
+	return indices;
+}
+
 void update_vertex_buffer( const std::vector<vertex>& vertices, uint N )
 {
 	static GLuint vertex_buffer = 0;	// ID holder for vertex buffer
 	static GLuint index_buffer = 0;		// ID holder for index buffer
+	if(raster.b_enabled) return;		// the software rasterizer reads unit_circle_vertices directly
 
 	// clear and create new buffers
 	if(vertex_buffer)	glDeleteBuffers( 1, &vertex_buffer );	vertex_buffer = 0;
@@ -186,18 +286,13 @@ void update_vertex_buffer( const std::vector<vertex>& vertices, uint N )
 	// create buffers
 	if(b_index_buffer)
 	{
-		std::vector<uint> indices;
-		for( uint k=0; k < N; k++ )
-		{
-			indices.push_back(0);	// the origin
-			indices.push_back(k+1);
-			indices.push_back(k+2);
-		}
+		std::vector<uint> indices = create_circle_indices( N );
 
 		// generation of vertex buffer: use vertices as it is
 		glGenBuffers( 1, &vertex_buffer );
 		glBindBuffer( GL_ARRAY_BUFFER, vertex_buffer );
-		glBufferData( GL_ARRAY_BUFFER, sizeof(vertex)*vertices.size(), &vertices[0], GL_STATIC_DRAW);
+		std::vector<unsigned char> packed = pack_vertices( vformat, vertices );
+		glBufferData( GL_ARRAY_BUFFER, packed.size(), packed.data(), GL_STATIC_DRAW);
 
 		// geneation of index buffer
 		glGenBuffers( 1, &index_buffer );
@@ -217,20 +312,40 @@ void update_vertex_buffer( const std::vector<vertex>& vertices, uint N )
 		// generation of vertex buffer: use triangle_vertices instead of vertices
 		glGenBuffers( 1, &vertex_buffer );
 		glBindBuffer( GL_ARRAY_BUFFER, vertex_buffer );
-		glBufferData( GL_ARRAY_BUFFER, sizeof(vertex)*v.size(), &v[0], GL_STATIC_DRAW );
+		std::vector<unsigned char> packed = pack_vertices( vformat, v );
+		glBufferData( GL_ARRAY_BUFFER, packed.size(), packed.data(), GL_STATIC_DRAW );
 	}
 
 	// generate vertex array object, which is mandatory for OpenGL 3.3 and higher
 	if(vertex_array) glDeleteVertexArrays(1,&vertex_array);
-	vertex_array = cg_create_vertex_array( vertex_buffer, index_buffer );
+	vertex_array = create_vertex_array( vformat, vertex_buffer, index_buffer );
 	if(!vertex_array){ printf("%s(): failed to create vertex aray\n",__func__); return; }
+
+	// per-instance attributes of the instanced path, advanced once per circle
+	// it always holds one instance at least, since the per-circle draws still fetch instance 0 of the enabled attributes
+	if(!instance_buffer)
+	{
+		circle_instance none = { vec3(0), vec4(0) };
+		glGenBuffers( 1, &instance_buffer );
+		glBindBuffer( GL_ARRAY_BUFFER, instance_buffer );
+		glBufferData( GL_ARRAY_BUFFER, sizeof(circle_instance), &none, GL_STREAM_DRAW );
+	}
+	glBindVertexArray( vertex_array );
+	glBindBuffer( GL_ARRAY_BUFFER, instance_buffer );
+	glEnableVertexAttribArray( 3 );
+	glVertexAttribPointer( 3, 3, GL_FLOAT, GL_FALSE, sizeof(circle_instance), (const void*) 0 );
+	glVertexAttribDivisor( 3, 1 );
+	glEnableVertexAttribArray( 4 );
+	glVertexAttribPointer( 4, 4, GL_FLOAT, GL_FALSE, sizeof(circle_instance), (const void*) sizeof(vec3) );
+	glVertexAttribDivisor( 4, 1 );
+	glBindVertexArray( 0 );
 }
 
 void keyboard( GLFWwindow* window, int key, int scancode, int action, int mods )
 {
 	if(action==GLFW_PRESS)
 	{
-		if(key==GLFW_KEY_ESCAPE||key==GLFW_KEY_Q)	glfwSetWindowShouldClose( window, GL_TRUE );
+		if(key==GLFW_KEY_ESCAPE||key==GLFW_KEY_Q){ if(window) glfwSetWindowShouldClose( window, GL_TRUE ); }	// no window in a headless replay
 		else if(key==GLFW_KEY_H||key==GLFW_KEY_F1)	print_help();
 		else if(key==GLFW_KEY_KP_SUBTRACT||key==GLFW_KEY_MINUS) b.sub = true;
 		else if(key==GLFW_KEY_I)
@@ -239,8 +354,49 @@ void keyboard( GLFWwindow* window, int key, int scancode, int action, int mods )
 			update_vertex_buffer( unit_circle_vertices,TESS );
 			printf( "> using %s buffering\n", b_index_buffer?"index":"vertex" );
 		}
+		else if(key==GLFW_KEY_N)
+		{
+			b_instanced = !b_instanced;
+			printf( "> using %s drawing\n", b_instanced?"instanced":"per-circle" );
+		}
+		else if(key==GLFW_KEY_V)
+		{
+			vformat = vertex_format((vformat+1)%NUM_VERTEX_FORMATS);
+			update_vertex_buffer( unit_circle_vertices,TESS );
+			printf( "> using %s vertices: %u bytes each\n", vertex_format_names[vformat], vertex_stride(vformat) );
+		}
+		else if(key==GLFW_KEY_O)
+		{
+			b_impostor = !b_impostor;
+			printf( "> using %s\n", b_impostor?"disc impostors":"circle meshes" );
+		}
+		else if(key==GLFW_KEY_P)
+		{
+			b_stats = !b_stats;
+			printf( "> %s stats\n", b_stats?"printing":"hiding" );
+		}
+		else if(key==GLFW_KEY_F)
+		{
+			b_culling = !b_culling;
+			printf( "> %s culling\n", b_culling?"using":"not using" );
+		}
+		else if(key==GLFW_KEY_U)
+		{
+			uniforms.b_bypass = !uniforms.b_bypass;
+			printf( "> using %s uniforms\n", uniforms.b_bypass?"per-draw lookups of":"cached" );
+		}
+		else if(key==GLFW_KEY_C)
+		{
+			world.b_ccd = !world.b_ccd;
+			printf( "> %s continuous collision detection\n", world.b_ccd?"using":"not using" );
+		}
+		else if(key==GLFW_KEY_G)
+		{
+			world.b_grid = !world.b_grid;
+			printf( "> using %s collisions\n", world.b_grid?"grid broadphase":"brute-force" );
+		}
 #ifndef GL_ES_VERSION_2_0
-		else if(key==GLFW_KEY_W)
+		else if(key==GLFW_KEY_W&&!raster.b_enabled)
 		{
 			b_wireframe = !b_wireframe;
 			glPolygonMode( GL_FRONT_AND_BACK, b_wireframe ? GL_LINE:GL_FILL );
@@ -259,7 +415,7 @@ void mouse( GLFWwindow* window, int button, int action, int mods )
 {
 	if(button==GLFW_MOUSE_BUTTON_LEFT&&action==GLFW_PRESS )
 	{
-		dvec2 pos; glfwGetCursorPos(window,&pos.x,&pos.y);
+		dvec2 pos = replay().cursor_pos(window);
 		printf( "> Left mouse button pressed at (%d, %d)\n", int(pos.x), int(pos.y) );
 	}
 }
@@ -273,14 +429,22 @@ bool user_init()
 	// log hotkeys
 	print_help();
 
+	// define the position of four corner vertices
+	unit_circle_vertices = std::move(create_circle_vertices( TESS ));
+	unit_circle_indices = create_circle_indices( TESS );
+
+	// the same states on the CPU, without any GL object
+	if(raster.b_enabled)
+	{
+		raster.clear_color = vec4( 39/255.0f, 40/255.0f, 34/255.0f, 1.0f );	// culling and depth tests are on by default
+		return raster.resize( window_size );
+	}
+
 	// init GL states
 	glLineWidth( 1.0f );
 	glClearColor( 39/255.0f, 40/255.0f, 34/255.0f, 1.0f );	// set clear color 
 	glEnable( GL_CULL_FACE );								// turn on backface culling
 	glEnable( GL_DEPTH_TEST );								// turn on depth tests
-	
-	// define the position of four corner vertices
-	unit_circle_vertices = std::move(create_circle_vertices( TESS ));
 
 	// create vertex buffer; called again when index buffering mode is toggled
 	update_vertex_buffer( unit_circle_vertices, TESS );
@@ -294,31 +458,81 @@ void user_finalize()
 
 int main( int argc, char* argv[] )
 {
-	// create window and initialize OpenGL extensions
-	if(!(window = cg_create_window( window_name, window_size.x, window_size.y ))){ glfwTerminate(); return 1; }
-	if(!cg_init_extensions( window )){ glfwTerminate(); return 1; }	// init OpenGL extensions
+	// headless benchmark without creating a window
+	if(argc>1&&strcmp(argv[1],"--bench")==0){ run_collision_benchmark(); return 0; }
+	if(argc>1&&strcmp(argv[1],"--bench-integrate")==0){ run_integration_benchmark(); return 0; }
+	if(argc>1&&strcmp(argv[1],"--bench-response")==0){ run_response_benchmark( argc>2?size_t(atof(argv[2])):1000000, argc>3?uint(atoi(argv[3])):NUM_OF_BALLS ); return 0; }
+	if(argc>1&&strcmp(argv[1],"--bench-threads")==0){ run_thread_benchmark( argc>2?uint(atoi(argv[2])):1000000 ); return 0; }
+	if(argc>1&&strcmp(argv[1],"--bench-spawn")==0){ run_spawn_benchmark(); return 0; }
+	if(argc>1&&strcmp(argv[1],"--test-ccd")==0) return run_ccd_test() ? 0 : 1;
+	if(argc>1&&strcmp(argv[1],"--simulate")==0){ run_simulation( argc>2?float(atof(argv[2])):10.0f, argc>3?uint(atoi(argv[3])):NUM_OF_BALLS ); return 0; }
+
+	// scene options: "--balls N" for A/B comparisons of the drawing paths, "--seed S" for reproducible runs
+	uint num_balls = NUM_OF_BALLS;
+	for( int k=1; k+1 < argc; k++ )
+	{
+		if(strcmp(argv[k],"--balls")==0)		num_balls = uint(atoi(argv[++k]));
+		else if(strcmp(argv[k],"--seed")==0)	seed = uint(strtoul(argv[++k],nullptr,10));
+	}
+	// "--record file" or "--replay file"; a replay restores the seed and the window size of the recording
+	if(!replay().parse( argc, argv )) return 1;
+	if(replay().mode==INPUT_REPLAY){ seed = replay().seed; window_size = replay().size; }
+	world = circle_world(create_circles(num_balls,seed));
+	printf( "> %zu balls with seed %u\n", world.balls.size(), seed );
+
+	// create window and initialize OpenGL extensions, or an offscreen context for "--headless [frames]"
+	headless.size = window_size; headless.parse( argc, argv );
+	prof().parse( argc, argv );	// "--profile [prefix]" for the zones and their trace
+	raster.parse( argc, argv ); if(raster.b_enabled) headless.b_enabled = headless.b_software = true;	// "--software" is always offscreen
+	if(replay().mode==INPUT_REPLAY) headless.frames = replay().frames;
+	replay().seed = seed; replay().size = window_size;	// header of a recording
+	if(headless.b_enabled){ window_size = headless.size; if(!headless.create( window_name, window )){ glfwTerminate(); return 1; } }
+	else
+	{
+		if(!(window = cg_create_window( window_name, window_size.x, window_size.y ))){ glfwTerminate(); return 1; }
+		if(!cg_init_extensions( window )){ glfwTerminate(); return 1; }	// init OpenGL extensions
+	}
 
-	// initializations and validations of GLSL program
-	if(!(program=cg_create_program( vert_shader_path, frag_shader_path ))){ glfwTerminate(); return 1; }	// create and compile shaders/program
+	// initializations and validations of GLSL program; the software rasterizer needs none
+	if(!raster.b_enabled)
+	{
+		if(!(program=cg_create_program( vert_shader_path, frag_shader_path ))){ glfwTerminate(); return 1; }	// create and compile shaders/program
+		uniforms.reflect( program );
+		glUseProgram( program );	// uniforms are set in update() before render() binds the program
+		u.b_solid_color = uniforms.get<int>( "b_solid_color" );
+		u.b_instanced = uniforms.get<int>( "b_instanced" );
+		u.b_impostor = uniforms.get<int>( "b_impostor" );
+		u.aspect_matrix = uniforms.get<mat4>( "aspect_matrix" );
+		u.model_matrix = uniforms.get<mat4>( "model_matrix" );
+		u.solid_color = uniforms.get<vec4>( "solid_color" );
+		u.vertex_format = uniforms.get<uint>( "vertex_format" );
+	}
 	if(!user_init()){ printf( "Failed to user_init()\n" ); glfwTerminate(); return 1; }					// user initialization
+	if(!raster.b_enabled) gpu_prof().create();	// timer queries when profiling
 
-	// register event callbacks
-	glfwSetWindowSizeCallback( window, reshape );	// callback for window resizing events
-    glfwSetKeyCallback( window, keyboard );			// callback for keyboard events
-	glfwSetMouseButtonCallback( window, mouse );	// callback for mouse click inputs
-	glfwSetCursorPosCallback( window, motion );		// callback for mouse movements
+	// register event callbacks for window resizing, keyboard, mouse click inputs and mouse movements;
+	// they are called through the recorder, which also feeds them a replay
+	replay().set_callbacks( window, reshape, keyboard, mouse, motion );
 
 	// enters rendering/event loop
-	for( frame=0; !glfwWindowShouldClose(window); frame++ )
+	headless.start();	// setup is not part of the measured frames
+	for( frame=0; headless.b_enabled ? headless.running(frame) : !glfwWindowShouldClose(window)&&replay().running(frame); frame++ )
 	{
-		glfwPollEvents();	// polling and processing of events
+		prof().begin_frame( frame ); gpu_prof().begin_frame( frame );
+		{ profile_zone zone( "input" ); replay().poll( window, frame ); }	// polling and processing of events, live or replayed
 		update();			// per-frame update
 		render();			// per-frame render
+		if(headless.b_enabled) headless.end_frame();
+		gpu_prof().end_frame(); prof().end_frame();
 	}
 	
 	// normal termination
+	replay().save( frame );	// when recording
+	gpu_prof().destroy();
+	prof().finish();	// frame-time percentiles and the trace files
 	user_finalize();
-	cg_destroy_window(window);
+	headless.finish( raster.b_enabled ? raster.rgb().data() : nullptr );	// stats and the last frame, then the offscreen context
+	if(window) cg_destroy_window(window);
 
 	return 0;
 }
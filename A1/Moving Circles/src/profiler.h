@@ -0,0 +1,177 @@
+#pragma once
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include "cgmath.h"		// no GL or GLFW dependency below this point
+
+//*************************************
+// one timed zone of a frame; GPU zones are converted to the CPU clock and carry PROFILE_GPU_THREAD
+struct profile_sample
+{
+	const char*	name;			// string literal
+	double		begin, end;		// seconds of profile_time()
+	int			frame;
+	uint		thread;
+};
+
+static const uint	PROFILE_GPU_THREAD = 1000;		// track of the GPU zones in the trace
+static const size_t	PROFILE_RING_SIZE = 1<<16;		// samples kept; older ones are overwritten
+
+inline double profile_time()
+{
+	static const auto t0 = std::chrono::steady_clock::now();
+	return std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count();
+}
+
+// small per-thread index in the order of the first zone; the main thread takes 0 in profiler::parse()
+inline uint profile_thread()
+{
+	static std::atomic<uint> next{0};
+	thread_local uint index = next++;
+	return index;
+}
+
+//*************************************
+// multi-producer ring of samples: a writer claims a slot with one fetch_add and publishes it
+// with a release store of its sequence, so zones on worker threads never take a lock;
+// a reader keeps the slots whose sequence matches their position
+struct profile_ring
+{
+	struct slot { std::atomic<size_t> seq{0}; profile_sample sample; };
+	std::unique_ptr<slot[]>	slots;
+	std::atomic<size_t>		head{0};
+
+	void create(){ slots.reset( new slot[PROFILE_RING_SIZE] ); }
+	void push( const profile_sample& s )
+	{
+		size_t i = head.fetch_add( 1, std::memory_order_relaxed );
+		slot& d = slots[i&(PROFILE_RING_SIZE-1)];
+		d.seq.store( 0, std::memory_order_relaxed );
+		d.sample = s;
+		d.seq.store( i+1, std::memory_order_release );
+	}
+	std::vector<profile_sample> snapshot() const	// oldest first
+	{
+		std::vector<profile_sample> v; size_t h = head.load( std::memory_order_acquire );
+		for( size_t i=h>PROFILE_RING_SIZE?h-PROFILE_RING_SIZE:0; i < h; i++ )
+		{
+			const slot& s = slots[i&(PROFILE_RING_SIZE-1)];
+			if(s.seq.load(std::memory_order_acquire)==i+1) v.push_back( s.sample );
+		}
+		return v;
+	}
+};
+
+//*************************************
+// frame times are always kept for the percentiles on exit; zones are recorded with "--profile [prefix]",
+// which writes prefix.json (chrome://tracing, Perfetto) and prefix.csv at the end
+struct profiler
+{
+	bool				b_enabled = false;
+	const char*			prefix = "profile";
+	profile_ring		ring;
+	std::vector<float>	cpu_frame_ms, gpu_frame_ms;		// wall-clock period and GPU time of every frame
+	std::atomic<int>	frame{0};
+	double				frame_begin = 0.0;
+
+	void	parse( int argc, char* argv[] );
+	void	begin_frame( int f ){ frame = f; frame_begin = profile_time(); }
+	void	end_frame(){ double t = profile_time(); cpu_frame_ms.push_back( float((t-frame_begin)*1000) ); if(b_enabled) record( "frame", frame_begin, t, 0 ); }
+	void	record( const char* name, double begin, double end, uint thread ){ ring.push( { name, begin, end, frame.load(std::memory_order_relaxed), thread } ); }
+	void	report() const;
+	bool	write_trace( const char* path ) const;
+	bool	write_csv( const char* path ) const;
+	void	finish();
+};
+
+inline profiler& prof(){ static profiler p; return p; }
+
+// CPU time of the enclosing scope; costs one branch when profiling is off
+struct profile_zone
+{
+	const char*	name;
+	double		begin;
+	profile_zone( const char* name ) : name(name), begin(prof().b_enabled?profile_time():0.0){}
+	~profile_zone(){ if(prof().b_enabled) prof().record( name, begin, profile_time(), profile_thread() ); }
+};
+
+//*************************************
+inline void profiler::parse( int argc, char* argv[] )
+{
+	profile_thread();	// the main thread becomes thread 0
+	for( int k=1; k < argc; k++ )
+	{
+		if(strcmp(argv[k],"--profile")!=0) continue;
+		b_enabled = true;
+		if(k+1<argc&&argv[k+1][0]!='-') prefix = argv[++k];
+	}
+	if(b_enabled){ ring.create(); printf( "> profiling to %s.json and %s.csv\n", prefix, prefix ); }
+}
+
+// nearest-rank percentiles
+inline void profiler::report() const
+{
+	auto print = []( const char* label, std::vector<float> v )
+	{
+		if(v.empty()) return;
+		std::sort( v.begin(), v.end() );
+		auto p = [&]( float q ){ return v[std::min(v.size()-1,size_t(ceil(q*v.size()))-1)]; };
+		printf( "> %s frame times of %zu frames: p50 %.3f ms, p95 %.3f ms, p99 %.3f ms, max %.3f ms\n", label, v.size(), p(0.50f), p(0.95f), p(0.99f), v.back() );
+	};
+	print( "CPU", cpu_frame_ms );
+	print( "GPU", gpu_frame_ms );
+}
+
+// chrome trace event format: complete events ("X") in microseconds, and the names of the tracks
+inline bool profiler::write_trace( const char* path ) const
+{
+	FILE* fp = fopen( path, "w" ); if(!fp){ printf( "%s(): unable to open %s\n", __func__, path ); return false; }
+	auto samples = ring.snapshot();
+	std::vector<uint> threads; for( auto& s : samples ) threads.push_back( s.thread );
+	std::sort( threads.begin(), threads.end() ); threads.erase( std::unique(threads.begin(),threads.end()), threads.end() );
+	fprintf( fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" );
+	for( uint t : threads )
+	{
+		if(t==PROFILE_GPU_THREAD) fprintf( fp, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"GPU\"}},\n", t );
+		else if(t==0) fprintf( fp, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"main\"}},\n" );
+		else fprintf( fp, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"worker %u\"}},\n", t, t );
+	}
+	for( size_t k=0; k < samples.size(); k++ )
+	{
+		const profile_sample& s = samples[k];
+		fprintf( fp, "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"frame\":%d}}%s\n",
+			s.name, s.thread==PROFILE_GPU_THREAD?"gpu":"cpu", s.begin*1e6, (s.end-s.begin)*1e6, s.thread, s.frame, k+1<samples.size()?",":"" );
+	}
+	fprintf( fp, "]}\n" );
+	fclose( fp );
+	return true;
+}
+
+inline bool profiler::write_csv( const char* path ) const
+{
+	FILE* fp = fopen( path, "w" ); if(!fp){ printf( "%s(): unable to open %s\n", __func__, path ); return false; }
+	fprintf( fp, "frame,thread,zone,begin_ms,duration_ms\n" );
+	for( auto& s : ring.snapshot() ) fprintf( fp, "%d,%s%u,%s,%.4f,%.4f\n", s.frame, s.thread==PROFILE_GPU_THREAD?"gpu":"cpu", s.thread==PROFILE_GPU_THREAD?0:s.thread, s.name, s.begin*1000, (s.end-s.begin)*1000 );
+	fclose( fp );
+	return true;
+}
+
+// percentiles, then the trace files when profiling; call after the last frame
+inline void profiler::finish()
+{
+	report();
+	if(!b_enabled) return;
+	std::vector<char> path( strlen(prefix)+8 );
+	snprintf( path.data(), path.size(), "%s.json", prefix ); bool b_trace = write_trace( path.data() );
+	snprintf( path.data(), path.size(), "%s.csv", prefix ); bool b_csv = write_csv( path.data() );
+	if(b_trace&&b_csv) printf( "> %zu samples written to %s.json and %s.csv\n", std::min(ring.head.load(),PROFILE_RING_SIZE), prefix, prefix );
+}
+
+#endif // __PROFILER_H__
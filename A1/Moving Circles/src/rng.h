@@ -0,0 +1,26 @@
+#pragma once
+#ifndef __RNG_H__
+#define __RNG_H__
+#include <cstdint>
+
+//*************************************
+// seedable PCG32 generator; the same seed gives the same sequence on every platform, unlike rand()
+struct pcg32
+{
+	uint64_t	state = 0;
+
+	pcg32( uint64_t seed ){ next(); state += seed; next(); }
+	uint32_t	next();
+	float		uniform(){ return (next()>>8)*(1.0f/16777216.0f); }	// [0,1)
+	float		uniform( float a, float b ){ return a+(b-a)*uniform(); }	// [a,b)
+};
+
+inline uint32_t pcg32::next()
+{
+	uint64_t old = state;
+	state = old*6364136223846793005ull+1442695040888963407ull;
+	uint32_t xorshifted = uint32_t(((old>>18)^old)>>27), rot = uint32_t(old>>59);
+	return (xorshifted>>rot)|(xorshifted<<((32-rot)&31));
+}
+
+#endif // __RNG_H__
@@ -0,0 +1,411 @@
+#pragma once
+#ifndef __SOFT_RASTER_H__
+#define __SOFT_RASTER_H__
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "cgmath.h"
+#include "cgut.h"		// vertex
+#include "thread_pool.h"
+
+// SSE2 on any x64, otherwise scalar only; the edge functions of four pixels are one vector of 32-bit integers
+#if defined(__SSE2__)||defined(_M_X64)||(defined(_M_IX86_FP)&&_M_IX86_FP>=2)
+	#include <emmintrin.h>
+	#define CG_RASTER_SSE2
+#endif
+
+//*************************************
+// CPU backend of the mesh programs (transform.vert/frag and circ.vert/frag) for machines without a GPU or Mesa:
+// indexed triangles through a model-view-projection matrix, clipping, back-face culling as GL_CULL_FACE
+// (GL_BACK, GL_CCW), the GL_LESS depth test, and the texcoord or solid colors of the fragment shaders
+// draws are only recorded; end_frame() sets up and bins the triangles into tiles in parallel over ranges of
+// triangles, then rasterizes the tiles in parallel, each by one thread in the order of the draws
+static const int	RASTER_TILE = 64;			// pixels per side of a tile; a multiple of 4
+static const int	RASTER_SUBPIXEL = 16;		// 4 bits of subpixel precision, as on most GPUs
+static const float	RASTER_GUARD_BAND = 2.0f;	// triangles within twice the viewport are not clipped in x and y
+static const int	RASTER_MAX_SIZE = 8192;		// largest target whose edge functions stay in 32 bits within a tile
+static const uint	RASTER_BATCH = 1024;		// triangles per setup task at least
+
+struct raster_draw
+{
+	mat4			mvp;		// model-view-projection matrix
+	const vertex*	vertices;
+	const uint*		indices;	// absolute into vertices
+	uint			first;		// index of the first triangle in the frame
+	uint			count;		// triangles
+	uint			color;		// RGBA8 of a solid color
+	bool			b_solid;	// solid color instead of the texcoords?
+};
+
+// output of the vertex stage; shared by the triangles of an indexed mesh, so it is projected only once
+struct raster_vertex
+{
+	vec4	p;			// clip coordinates
+	vec2	tc;
+	int		x, y;		// window coordinates in subpixels, valid inside the guard band
+	float	z, iw;		// window depth and 1/w
+	uint	view, guard;	// planes of the view volume and of the guard band outside which the vertex lies
+};
+
+// triangle after setup: counterclockwise subpixel positions for the coverage, and planes of the interpolants
+struct raster_triangle
+{
+	int		x[3], y[3];			// window coordinates in subpixels
+	int		x0, y0, x1, y1;		// pixels [x0,x1)x[y0,y1) of the bounding box inside the target
+	float	px, py;				// window position of vertex 0, the origin of the planes
+	vec3	z, iw, u, v;		// (value at the origin, d/dx, d/dy) of depth, 1/w, u/w and v/w
+	uint	color;
+	bool	b_solid;
+};
+
+// triangles of one setup task, and their indices sorted by tile in the order of the draws
+struct raster_bin
+{
+	std::vector<raster_triangle>	triangles;
+	std::vector<uint>	first;		// offset of each tile in refs, and the end
+	std::vector<uint>	refs;
+	std::vector<raster_vertex>	post;	// scratch of the vertex stage
+	uint				culled = 0, clipped = 0;
+};
+
+inline uint raster_rgba8( vec4 c )
+{
+	auto b = []( float f ){ return uint(std::min(1.0f,std::max(0.0f,f))*255.0f+0.5f); };
+	return b(c.x)|b(c.y)<<8|b(c.z)<<16|b(c.w)<<24;
+}
+
+struct soft_rasterizer
+{
+	bool	b_enabled = false;	// "--software"
+	bool	b_cull = true;		// GL_CULL_FACE
+	bool	b_depth = true;		// GL_DEPTH_TEST
+	vec4	clear_color = vec4(0,0,0,1);
+	ivec2	size = ivec2(0);
+	int		stride = 0;			// pixels per row, a multiple of 4
+	ivec2	tiles = ivec2(0);
+	std::vector<uint>		color;	// RGBA8 with the rows bottom-up, as in GL
+	std::vector<float>		depth;
+	std::vector<raster_draw>	draws;
+	std::vector<raster_bin>		bins;
+	uint	num_bins = 0;		// bins used by the last frame
+	uint	triangles = 0;		// submitted in this frame
+
+	void	parse( int argc, char* argv[] );
+	bool	resize( ivec2 s );
+	void	begin_frame(){ draws.clear(); triangles = 0; }
+	void	draw( const mat4& mvp, const vertex* vertices, const uint* indices, uint index_count, const vec4* solid_color=nullptr );
+	void	end_frame();
+	std::vector<unsigned char>	rgb() const;	// bottom-up rows, as glReadPixels() returns them
+
+	void	setup( raster_bin& bin, uint first, uint last ) const;
+	void	project( raster_vertex& v, bool b_clipped=false ) const;
+	void	clip( raster_bin& bin, const raster_vertex& a, const raster_vertex& b, const raster_vertex& c, uint color, bool b_solid ) const;
+	void	emit( raster_bin& bin, const raster_vertex& a, const raster_vertex& b, const raster_vertex& c, uint color, bool b_solid ) const;
+	void	raster_tile( uint tile );
+	void	fill( const raster_triangle& t, int tx0, int ty0, int tx1, int ty1 );
+};
+
+//*************************************
+inline void soft_rasterizer::parse( int argc, char* argv[] )
+{
+	for( int k=1; k < argc; k++ ) if(strcmp(argv[k],"--software")==0) b_enabled = true;
+}
+
+inline bool soft_rasterizer::resize( ivec2 s )
+{
+	if(s.x<=0||s.y<=0||s.x>RASTER_MAX_SIZE||s.y>RASTER_MAX_SIZE){ printf( "%s(): %dx%d is not within 1 to %d pixels\n", __func__, s.x, s.y, RASTER_MAX_SIZE ); return false; }
+	size = s; stride = (s.x+3)&~3;
+	tiles = ivec2( (s.x+RASTER_TILE-1)/RASTER_TILE, (s.y+RASTER_TILE-1)/RASTER_TILE );
+	color.assign( size_t(stride)*s.y, 0 );
+	depth.assign( size_t(stride)*s.y, 1.0f );
+#if defined(CG_RASTER_SSE2)
+	const char* simd = "SSE2";
+#else
+	const char* simd = "scalar";
+#endif
+	printf( "> software rasterizer at %dx%d: %d tiles of %dx%d, %u threads, %s edge functions\n", s.x, s.y, tiles.x*tiles.y, RASTER_TILE, RASTER_TILE, default_thread_pool().size(), simd );
+	return true;
+}
+
+// records an indexed triangle list, like glDrawElements( GL_TRIANGLES ) under a program of the given matrix
+inline void soft_rasterizer::draw( const mat4& mvp, const vertex* vertices, const uint* indices, uint index_count, const vec4* solid_color )
+{
+	if(index_count<3) return;
+	draws.push_back( { mvp, vertices, indices, triangles, index_count/3, solid_color ? raster_rgba8(*solid_color) : 0, solid_color!=nullptr } );
+	triangles += index_count/3;
+}
+
+inline std::vector<unsigned char> soft_rasterizer::rgb() const
+{
+	std::vector<unsigned char> pixels( size_t(size.x)*size.y*3 );
+	for( int y=0; y < size.y; y++ ) for( int x=0; x < size.x; x++ )
+	{
+		uint c = color[size_t(y)*stride+x]; unsigned char* p = &pixels[(size_t(y)*size.x+x)*3];
+		p[0] = (unsigned char)c; p[1] = (unsigned char)(c>>8); p[2] = (unsigned char)(c>>16);
+	}
+	return pixels;
+}
+
+//*************************************
+// geometry in parallel over triangle ranges, then the tiles in parallel; every tile is cleared by its thread
+inline void soft_rasterizer::end_frame()
+{
+	thread_pool& pool = default_thread_pool();
+	num_bins = std::max( 1u, std::min( pool.size()*4, (triangles+RASTER_BATCH-1)/RASTER_BATCH ) );
+	if(bins.size()<num_bins) bins.resize( num_bins );
+	uint step = (triangles+num_bins-1)/num_bins;
+	pool.run( num_bins, [&]( uint b ){ setup( bins[b], std::min(triangles,b*step), std::min(triangles,b*step+step) ); } );
+	pool.run( uint(tiles.x*tiles.y), [&]( uint tile ){ raster_tile( tile ); } );
+}
+
+// vertex stage and setup of the triangles [first,last) of the frame, binned by tile
+inline void soft_rasterizer::setup( raster_bin& bin, uint first, uint last ) const
+{
+	bin.triangles.clear(); bin.culled = bin.clipped = 0;
+	if(first<last)
+	{
+		auto d = std::upper_bound( draws.begin(), draws.end(), first, []( uint t, const raster_draw& d ){ return t < d.first; } )-1;
+		for( ; d != draws.end() && d->first < last; ++d )
+		{
+			uint a = std::max(first,d->first)-d->first, b = std::min(last,d->first+d->count)-d->first;
+			if(a>=b) continue;
+
+			// each vertex in the range referenced by the triangles is transformed and projected once
+			const uint* idx = d->indices+size_t(a)*3; size_t n = size_t(b-a)*3;
+			uint lo = *std::min_element(idx,idx+n), hi = *std::max_element(idx,idx+n);
+			bin.post.resize( hi-lo+1 );
+			for( uint k=lo; k <= hi; k++ )
+			{
+				raster_vertex& v = bin.post[k-lo];
+				v.p = d->mvp*vec4(d->vertices[k].pos,1.0f); v.tc = d->vertices[k].tex;
+				project( v );
+			}
+
+			// trivial rejection against the view volume; only the triangles beyond the guard band or
+			// the near and far planes are clipped
+			for( size_t k=0; k < n; k += 3 )
+			{
+				const raster_vertex &v0 = bin.post[idx[k]-lo], &v1 = bin.post[idx[k+1]-lo], &v2 = bin.post[idx[k+2]-lo];
+				if(v0.view&v1.view&v2.view) continue;
+				if(v0.guard|v1.guard|v2.guard) clip( bin, v0, v1, v2, d->color, d->b_solid );
+				else emit( bin, v0, v1, v2, d->color, d->b_solid );
+			}
+		}
+	}
+
+	// counting sort of the references by tile; stable, so each tile keeps the order of the draws
+	bin.first.assign( size_t(tiles.x)*tiles.y+1, 0 );
+	for( int pass=0; pass < 2; pass++ )
+	{
+		if(pass==1)
+		{
+			for( size_t k=1; k < bin.first.size(); k++ ) bin.first[k] += bin.first[k-1];
+			bin.refs.resize( bin.first.back() );
+		}
+		for( uint k=0; k < uint(bin.triangles.size()); k++ )
+		{
+			const raster_triangle& t = bin.triangles[k];
+			for( int ty=t.y0/RASTER_TILE; ty <= (t.y1-1)/RASTER_TILE; ty++ )
+				for( int tx=t.x0/RASTER_TILE; tx <= (t.x1-1)/RASTER_TILE; tx++ )
+				{
+					uint tile = uint(ty*tiles.x+tx);
+					if(pass==0) bin.first[tile+1]++; else bin.refs[bin.first[tile]++] = k;
+				}
+		}
+	}
+	for( size_t k=bin.first.size()-1; k > 0; k-- ) bin.first[k] = bin.first[k-1];	// the fill advanced each offset to the next tile
+	bin.first[0] = 0;
+}
+
+// outcodes, and window coordinates when inside the guard band; clipped vertices are on its planes up to rounding
+inline void soft_rasterizer::project( raster_vertex& v, bool b_clipped ) const
+{
+	const vec4& p = v.p; float g = RASTER_GUARD_BAND*p.w;
+	v.view = (p.x<-p.w?1:0)|(p.x>p.w?2:0)|(p.y<-p.w?4:0)|(p.y>p.w?8:0)|(p.z<-p.w?16:0)|(p.z>p.w?32:0);
+	v.guard = (p.x<-g?1:0)|(p.x>g?2:0)|(p.y<-g?4:0)|(p.y>g?8:0)|(p.z<-p.w?16:0)|(p.z>p.w?32:0);
+	if(v.guard&&!b_clipped) return;
+	v.iw = 1.0f/p.w; v.z = p.z*v.iw*0.5f+0.5f;
+	v.x = int(floor((p.x*v.iw*0.5f+0.5f)*size.x*RASTER_SUBPIXEL+0.5f));
+	v.y = int(floor((p.y*v.iw*0.5f+0.5f)*size.y*RASTER_SUBPIXEL+0.5f));
+}
+
+// Sutherland-Hodgman against the crossed planes in clip coordinates; the convex result is drawn as a fan
+inline void soft_rasterizer::clip( raster_bin& bin, const raster_vertex& a, const raster_vertex& b, const raster_vertex& c, uint color, bool b_solid ) const
+{
+	raster_vertex poly[2][9] = { { a, b, c } }; int n = 3, cur = 0;
+	uint planes = a.guard|b.guard|c.guard;
+	auto distance = []( const vec4& p, int plane )
+	{
+		float g = RASTER_GUARD_BAND*p.w;
+		switch(plane){ case 0: return p.x+g; case 1: return g-p.x; case 2: return p.y+g; case 3: return g-p.y; case 4: return p.z+p.w; default: return p.w-p.z; }
+	};
+	for( int plane=0; plane < 6 && n >= 3; plane++ )
+	{
+		if(!(planes&(1<<plane))) continue;
+		const raster_vertex* in = poly[cur]; raster_vertex* out = poly[cur^1]; int m = 0;
+		for( int k=0; k < n; k++ )
+		{
+			const raster_vertex &u = in[k], &v = in[(k+1)%n];
+			float du = distance(u.p,plane), dv = distance(v.p,plane);
+			if(du>=0) out[m++] = u;
+			if((du>=0)!=(dv>=0))
+			{
+				float s = du/(du-dv);
+				out[m].p = u.p+(v.p-u.p)*s; out[m].tc = u.tc+(v.tc-u.tc)*s; m++;
+			}
+		}
+		n = m; cur ^= 1;
+	}
+	bin.clipped++;
+	for( int k=0; k < n; k++ ) project( poly[cur][k], true );
+	for( int k=1; k+1 < n; k++ ) emit( bin, poly[cur][0], poly[cur][k], poly[cur][k+1], color, b_solid );
+}
+
+// culling by the winding in window coordinates, the covered pixels, and the planes of the interpolants
+inline void soft_rasterizer::emit( raster_bin& bin, const raster_vertex& a, const raster_vertex& b, const raster_vertex& c, uint color, bool b_solid ) const
+{
+	const raster_vertex* v[3] = { &a, &b, &c };
+	int64_t area = int64_t(b.x-a.x)*(c.y-a.y)-int64_t(c.x-a.x)*(b.y-a.y);
+	if(area==0) return;
+	if(area<0)	// clockwise is the back face
+	{
+		if(b_cull){ bin.culled++; return; }
+		std::swap( v[1], v[2] );
+	}
+
+	// pixels whose centers may be covered, clamped to the target
+	raster_triangle t;
+	for( int k=0; k < 3; k++ ){ t.x[k] = v[k]->x; t.y[k] = v[k]->y; }
+	auto floor_div = []( int n ){ return n>=0 ? n/RASTER_SUBPIXEL : -((-n+RASTER_SUBPIXEL-1)/RASTER_SUBPIXEL); };
+	int h = RASTER_SUBPIXEL/2;
+	t.x0 = std::max( 0, floor_div(std::min({t.x[0],t.x[1],t.x[2]})-h-1)+1 );
+	t.y0 = std::max( 0, floor_div(std::min({t.y[0],t.y[1],t.y[2]})-h-1)+1 );
+	t.x1 = std::min( size.x, floor_div(std::max({t.x[0],t.x[1],t.x[2]})-h)+1 );
+	t.y1 = std::min( size.y, floor_div(std::max({t.y[0],t.y[1],t.y[2]})-h)+1 );
+	if(t.x0>=t.x1||t.y0>=t.y1) return;
+
+	// planes over the snapped positions; depth and 1/w are affine in window coordinates, and so are u/w and v/w
+	double x0 = t.x[0]/double(RASTER_SUBPIXEL), y0 = t.y[0]/double(RASTER_SUBPIXEL);
+	double x1 = t.x[1]/double(RASTER_SUBPIXEL)-x0, y1 = t.y[1]/double(RASTER_SUBPIXEL)-y0;
+	double x2 = t.x[2]/double(RASTER_SUBPIXEL)-x0, y2 = t.y[2]/double(RASTER_SUBPIXEL)-y0;
+	double det = x1*y2-x2*y1;
+	auto plane = [&]( double f0, double f1, double f2 ){ double d1 = f1-f0, d2 = f2-f0; return vec3( float(f0), float((d1*y2-d2*y1)/det), float((d2*x1-d1*x2)/det) ); };
+	t.px = float(x0); t.py = float(y0);
+	t.z = plane( v[0]->z, v[1]->z, v[2]->z );
+	t.iw = plane( v[0]->iw, v[1]->iw, v[2]->iw );
+	t.u = plane( v[0]->tc.x*v[0]->iw, v[1]->tc.x*v[1]->iw, v[2]->tc.x*v[2]->iw );
+	t.v = plane( v[0]->tc.y*v[0]->iw, v[1]->tc.y*v[1]->iw, v[2]->tc.y*v[2]->iw );
+	t.color = color; t.b_solid = b_solid;
+	bin.triangles.push_back( t );
+}
+
+//*************************************
+inline void soft_rasterizer::raster_tile( uint tile )
+{
+	int tx0 = int(tile%tiles.x)*RASTER_TILE, ty0 = int(tile/tiles.x)*RASTER_TILE;
+	int tx1 = std::min( tx0+RASTER_TILE, size.x ), ty1 = std::min( ty0+RASTER_TILE, size.y );
+
+	// the last column of tiles also clears the padding of the rows
+	uint c = raster_rgba8( clear_color ); int w = std::min( tx0+RASTER_TILE, stride )-tx0;
+	for( int y=ty0; y < ty1; y++ )
+	{
+		std::fill_n( color.begin()+size_t(y)*stride+tx0, w, c );
+		std::fill_n( depth.begin()+size_t(y)*stride+tx0, w, 1.0f );
+	}
+	for( uint b=0; b < num_bins; b++ )
+	{
+		const raster_bin& bin = bins[b];
+		for( uint r=bin.first[tile]; r < bin.first[tile+1]; r++ ) fill( bin.triangles[bin.refs[r]], tx0, ty0, tx1, ty1 );
+	}
+}
+
+// coverage, depth test and shading of a triangle within a tile
+inline void soft_rasterizer::fill( const raster_triangle& t, int tx0, int ty0, int tx1, int ty1 )
+{
+	int x0 = std::max(t.x0,tx0), x1 = std::min(t.x1,tx1), y0 = std::max(t.y0,ty0), y1 = std::min(t.y1,ty1);
+	if(x0>=x1||y0>=y1) return;
+
+	// edge functions at the pixel centers, inside when >= 0 for counterclockwise vertices; a bias of -1 on the
+	// edges that are neither top nor left leaves their pixel centers to the neighbor (top-left rule)
+	// an edge that covers the whole rectangle needs no test, and the others fit in 32 bits within a tile
+	int E[3], A[3], B[3], m = 0;
+	for( int i=0; i < 3; i++ )
+	{
+		int j = (i+1)%3;
+		int64_t dx = t.x[j]-t.x[i], dy = t.y[j]-t.y[i];
+		int64_t e = dx*(int64_t(y0)*RASTER_SUBPIXEL+RASTER_SUBPIXEL/2-t.y[i])-dy*(int64_t(x0)*RASTER_SUBPIXEL+RASTER_SUBPIXEL/2-t.x[i]);
+		if(!(dy<0||(dy==0&&dx<0))) e--;
+		int64_t a = -dy*RASTER_SUBPIXEL, b = dx*RASTER_SUBPIXEL, aw = a*(x1-1-x0), bh = b*(y1-1-y0);
+		if(e+std::max<int64_t>(0,aw)+std::max<int64_t>(0,bh)<0) return;	// the rectangle is outside
+		if(e+std::min<int64_t>(0,aw)+std::min<int64_t>(0,bh)>=0) continue;	// inside
+		E[m] = int(e); A[m] = int(a); B[m] = int(b); m++;
+	}
+
+	int xs = x0&~3;	// tiles start on multiples of 4, and rows are padded to them
+	float fx = xs+0.5f-t.px, fy = y0+0.5f-t.py;
+#if defined(CG_RASTER_SSE2)
+	const __m128i lane = _mm_setr_epi32(0,1,2,3), vx0 = _mm_set1_epi32(x0-1), vx1 = _mm_set1_epi32(x1), none = _mm_set1_epi32(-1);
+	const __m128 flane = _mm_setr_ps(0,1,2,3), one = _mm_set1_ps(1.0f), zero = _mm_setzero_ps(), scale = _mm_set1_ps(255.0f), half = _mm_set1_ps(0.5f);
+	const __m128i alpha = _mm_set1_epi32(int(0xff000000)), solid = _mm_set1_epi32(int(t.color));
+	__m128i ea[3], es[3];
+	for( int i=0; i < m; i++ ){ ea[i] = _mm_setr_epi32(0,A[i],A[i]*2,A[i]*3); es[i] = _mm_set1_epi32(A[i]*4); }
+	auto row = [&]( const vec3& p, float y ){ return _mm_add_ps(_mm_set1_ps(p.x+p.y*fx+p.z*y),_mm_mul_ps(_mm_set1_ps(p.y),flane)); };
+	const __m128 zs = _mm_set1_ps(t.z.y*4), ws = _mm_set1_ps(t.iw.y*4), us = _mm_set1_ps(t.u.y*4), vs = _mm_set1_ps(t.v.y*4);
+	for( int y=y0; y < y1; y++, fy += 1.0f )
+	{
+		uint* crow = color.data()+size_t(y)*stride; float* drow = depth.data()+size_t(y)*stride;
+		__m128i e[3];
+		for( int i=0; i < m; i++ ) e[i] = _mm_add_epi32(_mm_set1_epi32(E[i]+A[i]*(xs-x0)+B[i]*(y-y0)),ea[i]);
+		__m128 z = row(t.z,fy), w = row(t.iw,fy), u = row(t.u,fy), v = row(t.v,fy);
+		for( int x=xs; x < x1; x += 4 )
+		{
+			__m128i xv = _mm_add_epi32(_mm_set1_epi32(x),lane);
+			__m128i mask = _mm_and_si128(_mm_cmpgt_epi32(xv,vx0),_mm_cmplt_epi32(xv,vx1));
+			for( int i=0; i < m; i++ ){ mask = _mm_and_si128(mask,_mm_cmpgt_epi32(e[i],none)); e[i] = _mm_add_epi32(e[i],es[i]); }
+			__m128 fm = _mm_castsi128_ps(mask);
+			if(_mm_movemask_ps(fm))
+			{
+				__m128 d = _mm_loadu_ps(drow+x);
+				if(b_depth) fm = _mm_and_ps(fm,_mm_cmplt_ps(z,d));
+				if(_mm_movemask_ps(fm))
+				{
+					if(b_depth) _mm_storeu_ps(drow+x,_mm_or_ps(_mm_and_ps(fm,z),_mm_andnot_ps(fm,d)));
+					__m128i c = solid;
+					if(!t.b_solid)	// vec4(tc.xy,0,1) with tc divided by the interpolated 1/w
+					{
+						__m128 r = _mm_div_ps(one,w);
+						__m128i cr = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_min_ps(one,_mm_max_ps(zero,_mm_mul_ps(u,r))),scale),half));
+						__m128i cg = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_min_ps(one,_mm_max_ps(zero,_mm_mul_ps(v,r))),scale),half));
+						c = _mm_or_si128(_mm_or_si128(cr,_mm_slli_epi32(cg,8)),alpha);
+					}
+					__m128i cm = _mm_castps_si128(fm), old = _mm_loadu_si128((const __m128i*)(crow+x));
+					_mm_storeu_si128((__m128i*)(crow+x),_mm_or_si128(_mm_and_si128(cm,c),_mm_andnot_si128(cm,old)));
+				}
+			}
+			z = _mm_add_ps(z,zs); w = _mm_add_ps(w,ws); u = _mm_add_ps(u,us); v = _mm_add_ps(v,vs);
+		}
+	}
+#else
+	for( int y=y0; y < y1; y++, fy += 1.0f )
+	{
+		uint* crow = color.data()+size_t(y)*stride; float* drow = depth.data()+size_t(y)*stride;
+		int e[3]; for( int i=0; i < m; i++ ) e[i] = E[i]+A[i]*(xs-x0)+B[i]*(y-y0);
+		float gx = fx;
+		for( int x=xs; x < x1; x++, gx += 1.0f )
+		{
+			bool b_in = x>=x0;
+			for( int i=0; i < m; i++ ){ b_in = b_in&&e[i]>=0; e[i] += A[i]; }
+			if(!b_in) continue;
+			float z = t.z.x+t.z.y*gx+t.z.z*fy;
+			if(b_depth){ if(!(z<drow[x])) continue; drow[x] = z; }
+			if(t.b_solid){ crow[x] = t.color; continue; }
+			float r = 1.0f/(t.iw.x+t.iw.y*gx+t.iw.z*fy);
+			crow[x] = raster_rgba8( vec4( (t.u.x+t.u.y*gx+t.u.z*fy)*r, (t.v.x+t.v.y*gx+t.v.z*fy)*r, 0.0f, 1.0f ) );
+		}
+	}
+#endif
+}
+
+#endif // __SOFT_RASTER_H__
@@ -0,0 +1,131 @@
+#pragma once
+#ifndef __UNIFORMS_H__
+#define __UNIFORMS_H__
+#include <cstring>
+#include <string>
+#include <vector>
+#include "cgmath.h"
+#include "cgut.h"
+
+//*************************************
+// GL calls issued in the current frame; the render loop resets it with gl_calls()={}
+struct gl_call_counter
+{
+	uint	lookups = 0;	// glGetUniformLocation
+	uint	uploads = 0;	// glUniform*
+	uint	skipped = 0;	// uploads not issued because the value had not changed
+	uint	others = 0;		// clears, binds, buffer updates and draws, counted with gl_count()
+	uint	total() const { return lookups+uploads+others; }
+};
+
+inline gl_call_counter& gl_calls(){ static gl_call_counter c; return c; }
+inline void gl_count( uint n=1 ){ gl_calls().others += n; }
+
+// counted version of the per-draw lookup of the original code
+inline GLint gl_uniform_location( GLuint program, const char* name ){ gl_calls().lookups++; return glGetUniformLocation( program, name ); }
+
+//*************************************
+// typed handle to an active uniform; invalid when the shader does not use it
+template <class T> struct uniform
+{
+	int		index = -1;
+	explicit operator bool() const { return index>=0; }
+};
+
+//*************************************
+// active uniforms of a program, enumerated once after linking
+// call set() while the program is in use; it skips the upload when the value equals the last one,
+// so the uniforms must be changed only through set() after reflect()
+struct program_uniforms
+{
+	struct entry
+	{
+		std::string	name;
+		GLint		location;
+		GLenum		type;
+		bool		b_cached = false;		// has a value been uploaded?
+		alignas(16) unsigned char value[sizeof(mat4)];	// the last uploaded value
+	};
+
+	GLuint				program = 0;
+	std::vector<entry>	entries;
+	bool				b_bypass = false;	// look up and upload on every set() like the original code, for A/B comparison
+
+	void	reflect( GLuint program );
+	template <class T> uniform<T>	get( const char* name ) const;
+	template <class T> bool			set( uniform<T> u, const T& v );
+};
+
+inline void program_uniforms::reflect( GLuint prog )
+{
+	program = prog;
+	entries.clear();
+	GLint count = 0, max_length = 0;
+	glGetProgramiv( prog, GL_ACTIVE_UNIFORMS, &count );
+	glGetProgramiv( prog, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length );
+
+	std::vector<char> name( std::max(1,max_length) );
+	for( GLint k=0; k < count; k++ )
+	{
+		GLint size; GLenum type; GLsizei length = 0;
+		glGetActiveUniform( prog, GLuint(k), GLsizei(name.size()), &length, &size, &type, name.data() );
+		std::string s( name.data(), length );
+		if(s.size()>3&&s.compare(s.size()-3,3,"[0]")==0) s.resize(s.size()-3);	// arrays are reported as "name[0]"
+		GLint location = glGetUniformLocation( prog, s.c_str() );
+		if(location<0) continue;	// members of uniform blocks have no location
+		entries.push_back( { s, location, type } );
+	}
+}
+
+// GL type of each uploadable C++ type
+template <class T> constexpr GLenum uniform_type();
+template <> constexpr GLenum uniform_type<float>(){ return GL_FLOAT; }
+template <> constexpr GLenum uniform_type<int>(){ return GL_INT; }
+template <> constexpr GLenum uniform_type<uint>(){ return GL_UNSIGNED_INT; }
+template <> constexpr GLenum uniform_type<vec2>(){ return GL_FLOAT_VEC2; }
+template <> constexpr GLenum uniform_type<vec3>(){ return GL_FLOAT_VEC3; }
+template <> constexpr GLenum uniform_type<vec4>(){ return GL_FLOAT_VEC4; }
+template <> constexpr GLenum uniform_type<mat4>(){ return GL_FLOAT_MAT4; }
+
+inline void uniform_upload( GLint loc, float v ){ glUniform1f( loc, v ); }
+inline void uniform_upload( GLint loc, int v ){ glUniform1i( loc, v ); }
+inline void uniform_upload( GLint loc, uint v ){ glUniform1ui( loc, v ); }
+inline void uniform_upload( GLint loc, const vec2& v ){ glUniform2fv( loc, 1, v ); }
+inline void uniform_upload( GLint loc, const vec3& v ){ glUniform3fv( loc, 1, v ); }
+inline void uniform_upload( GLint loc, const vec4& v ){ glUniform4fv( loc, 1, v ); }
+inline void uniform_upload( GLint loc, const mat4& v ){ glUniformMatrix4fv( loc, 1, GL_TRUE, v ); }
+
+template <class T> uniform<T> program_uniforms::get( const char* name ) const
+{
+	uniform<T> u;
+	for( int k=0; k < int(entries.size()); k++ )
+	{
+		if(entries[k].name!=name) continue;
+		GLenum type = entries[k].type;	// bools and samplers are set as int
+		if(type==uniform_type<T>()||(uniform_type<T>()==GL_INT&&(type==GL_BOOL||type==GL_SAMPLER_2D))) u.index = k;
+		else printf( "[warning] %s(): type mismatch of uniform %s\n", __func__, name );
+		break;
+	}
+	return u;
+}
+
+template <class T> bool program_uniforms::set( uniform<T> u, const T& v )
+{
+	static_assert( sizeof(T)<=sizeof(entry::value), "uniform type too large" );
+	if(!u) return false;
+	entry& e = entries[u.index];
+	if(b_bypass)
+	{
+		e.b_cached = false;
+		GLint location = gl_uniform_location( program, e.name.c_str() );
+		if(location>-1){ uniform_upload( location, v ); gl_calls().uploads++; }
+		return true;
+	}
+	if(e.b_cached&&memcmp(e.value,&v,sizeof(T))==0){ gl_calls().skipped++; return false; }
+	memcpy( e.value, &v, sizeof(T) ); e.b_cached = true;
+	uniform_upload( e.location, v );
+	gl_calls().uploads++;
+	return true;
+}
+
+#endif // __UNIFORMS_H__
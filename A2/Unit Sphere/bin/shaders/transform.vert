@@ -8,15 +8,45 @@ uniform mat4 model_matrix;
 uniform mat4 view_projection_matrix;
 uniform mat4	aspect_matrix;	// tricky 4x4 aspect-correction matrix
 uniform uint tc_mode;
+uniform uint vertex_format;	// 0: float, 1: octahedral normal, 2: 10:10:10:2 normal, 3: position only
+uniform bool b_procedural;	// build the UV sphere from gl_VertexID; no attributes are read
+uniform uint sphere_slices, sphere_stacks;	// resolution of the procedural sphere
 
 out vec3 norm;
 out vec2 tc;
 flat out uint tc_mode_fg;
+out vec3 sphere_pos;	// object-space position, for texcoords of position-only vertices
+
+// inverse of the octahedral map: unfold the lower hemisphere over the diagonals
+vec3 oct_decode( vec2 e )
+{
+	vec3 n = vec3(e,1.0-abs(e.x)-abs(e.y));
+	float t = max(-n.z,0.0);
+	n.xy += vec2(n.x>=0.0?-t:t,n.y>=0.0?-t:t);
+	return normalize(n);
+}
+
+const float PI = 3.141592653589793;
+
+// vertex of create_uv_sphere() for the non-indexed triangle list: six vertices per quad (i,j), whose
+// corners follow the index buffer, (0,0) (1,0) (1,1) (0,0) (1,1) (0,1), given as bit masks over the six
+void procedural_vertex( out vec3 p, out vec2 t )
+{
+	uint q = uint(gl_VertexID)/6u, c = uint(gl_VertexID)%6u;
+	uint i = q/sphere_stacks + ((0x16u>>c)&1u), j = q%sphere_stacks + ((0x34u>>c)&1u);
+	t = vec2(float(i)/float(sphere_slices), float(j)/float(sphere_stacks));
+	float phi = 2.0*PI*t.x, theta = PI-PI*t.y;
+	p = vec3(sin(theta)*cos(phi), sin(theta)*sin(phi), cos(theta));
+}
 
 void main()
 {
-	gl_Position = aspect_matrix * view_projection_matrix * model_matrix * vec4(position,1);
-	norm = normal;
-	tc = texcoord;
+	vec3 p = position; vec2 t = texcoord;
+	if(b_procedural) procedural_vertex(p, t);
+
+	gl_Position = aspect_matrix * view_projection_matrix * model_matrix * vec4(p,1);
+	norm = b_procedural||vertex_format==3u ? p : vertex_format==1u ? oct_decode(normal.xy) : normal;	// the normal of a unit sphere is its position
+	tc = t;
+	sphere_pos = p;
 	tc_mode_fg = tc_mode;
 }
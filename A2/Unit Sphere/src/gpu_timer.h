@@ -0,0 +1,137 @@
+#pragma once
+#ifndef __GPU_TIMER_H__
+#define __GPU_TIMER_H__
+#include "cgmath.h"
+#include "cgut.h"		// glad
+#include "profiler.h"
+
+//*************************************
+// GPU time of the frame (GL_TIME_ELAPSED) and of its zones (pairs of GL_TIMESTAMP), fed into prof()
+// the queries of frame f are read at frame f+GPU_TIMER_LATENCY, when the GPU has long finished them;
+// results that are still not available are dropped instead of waiting, so the timer never stalls the pipeline
+static const uint GPU_TIMER_LATENCY = 2;	// query sets in flight
+static const uint GPU_TIMER_ZONES = 16;		// zones per frame; more are not timed
+
+struct gpu_timer
+{
+	struct query_set
+	{
+		GLuint		elapsed = 0;
+		GLuint		stamps[GPU_TIMER_ZONES*2] = {};
+		const char*	names[GPU_TIMER_ZONES] = {};
+		uint		zones = 0;
+		int			frame = 0;
+		bool		b_pending = false;
+	};
+
+	bool		b_enabled = false;
+	bool		b_frame = false;	// between begin_frame() and end_frame()?
+	query_set	sets[GPU_TIMER_LATENCY];
+	uint		current = 0;
+	double		cpu0 = 0.0;		// profile_time() at the GPU timestamp gpu0
+	GLint64		gpu0 = 0;
+	uint		dropped = 0;	// query sets not available in time
+
+	void	create();
+	void	destroy();
+	void	begin_frame( int frame );
+	void	end_frame();
+	uint	begin_zone( const char* name );
+	void	end_zone( uint zone );
+	void	resolve( query_set& s, bool b_wait );
+};
+
+inline gpu_timer& gpu_prof(){ static gpu_timer t; return t; }
+
+// CPU and GPU time of the enclosing scope; must be on the thread of the GL context
+struct gpu_zone
+{
+	profile_zone	cpu;
+	uint			zone;
+	gpu_zone( const char* name ) : cpu(name), zone(gpu_prof().begin_zone(name)){}
+	~gpu_zone(){ gpu_prof().end_zone( zone ); }
+};
+
+#ifndef GL_ES_VERSION_2_0	// timer queries are not in OpenGL ES 3.0
+// call with the context current after prof().parse(); nothing is created unless profiling
+inline void gpu_timer::create()
+{
+	if(!prof().b_enabled) return;
+	for( auto& s : sets ){ glGenQueries( 1, &s.elapsed ); glGenQueries( GPU_TIMER_ZONES*2, s.stamps ); }
+
+	// the first elapsed query of a context may return an absolute time (e.g., on llvmpipe); spend it on a clear
+	GLuint64 ns; glBeginQuery( GL_TIME_ELAPSED, sets[0].elapsed ); glClear( GL_COLOR_BUFFER_BIT ); glEndQuery( GL_TIME_ELAPSED );
+	glGetQueryObjectui64v( sets[0].elapsed, GL_QUERY_RESULT, &ns );
+	glGetInteger64v( GL_TIMESTAMP, &gpu0 ); cpu0 = profile_time();
+	b_enabled = true;
+}
+
+// reads the sets still in flight, waiting this time, and deletes the queries
+inline void gpu_timer::destroy()
+{
+	if(!b_enabled) return;
+	for( uint k=0; k < GPU_TIMER_LATENCY; k++ ) resolve( sets[(current+k)%GPU_TIMER_LATENCY], true );	// oldest first
+	for( auto& s : sets ){ glDeleteQueries( 1, &s.elapsed ); glDeleteQueries( GPU_TIMER_ZONES*2, s.stamps ); }
+	if(dropped) printf( "> %u frames of GPU queries were not ready in time and dropped\n", dropped );
+	b_enabled = false;
+}
+
+inline void gpu_timer::resolve( query_set& s, bool b_wait )
+{
+	if(!s.b_pending) return;
+	s.b_pending = false;
+	GLint available = 0;	// the elapsed query ends last, so the timestamps are ready with it
+	if(!b_wait) glGetQueryObjectiv( s.elapsed, GL_QUERY_RESULT_AVAILABLE, &available );
+	if(!b_wait&&!available){ dropped++; return; }
+
+	GLuint64 ns; glGetQueryObjectui64v( s.elapsed, GL_QUERY_RESULT, &ns );
+	prof().gpu_frame_ms.push_back( float(ns*1e-6) );
+	for( uint z=0; z < s.zones; z++ )
+	{
+		GLuint64 t[2]; glGetQueryObjectui64v( s.stamps[z*2], GL_QUERY_RESULT, t ); glGetQueryObjectui64v( s.stamps[z*2+1], GL_QUERY_RESULT, t+1 );
+		prof().ring.push( { s.names[z], cpu0+(GLint64(t[0])-gpu0)*1e-9, cpu0+(GLint64(t[1])-gpu0)*1e-9, s.frame, PROFILE_GPU_THREAD } );
+	}
+}
+
+inline void gpu_timer::begin_frame( int frame )
+{
+	if(!b_enabled) return;
+	query_set& s = sets[current];
+	resolve( s, false );	// issued GPU_TIMER_LATENCY frames ago
+	s.zones = 0; s.frame = frame; s.b_pending = true;
+	glBeginQuery( GL_TIME_ELAPSED, s.elapsed );
+	b_frame = true;
+}
+
+inline void gpu_timer::end_frame()
+{
+	if(!b_frame) return;
+	glEndQuery( GL_TIME_ELAPSED );
+	b_frame = false;
+	current = (current+1)%GPU_TIMER_LATENCY;
+}
+
+inline uint gpu_timer::begin_zone( const char* name )
+{
+	query_set& s = sets[current];
+	if(!b_frame||s.zones==GPU_TIMER_ZONES) return uint(-1);
+	s.names[s.zones] = name;
+	glQueryCounter( s.stamps[s.zones*2], GL_TIMESTAMP );
+	return s.zones++;
+}
+
+inline void gpu_timer::end_zone( uint zone )
+{
+	if(zone!=uint(-1)) glQueryCounter( sets[current].stamps[zone*2+1], GL_TIMESTAMP );
+}
+#else
+inline void gpu_timer::create(){}
+inline void gpu_timer::destroy(){}
+inline void gpu_timer::resolve( query_set&, bool ){}
+inline void gpu_timer::begin_frame( int ){}
+inline void gpu_timer::end_frame(){}
+inline uint gpu_timer::begin_zone( const char* ){ return uint(-1); }
+inline void gpu_timer::end_zone( uint ){}
+#endif
+
+#endif // __GPU_TIMER_H__
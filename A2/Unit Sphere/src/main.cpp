@@ -1,5 +1,10 @@
 #include "cgmath.h"		// slee's simple math library
 #include "cgut.h"		// slee's OpenGL utility
+#include "uniforms.h"	// cached uniform locations and values
+#include "sphere_lod.h"	// sphere levels of detail
+#include "vertex_format.h"	// compact vertex layouts
+#include "headless.h"	// offscreen rendering without a window
+#include "gpu_timer.h"	// CPU and GPU frame profiler
 
 //*************************************
 // global constants
@@ -13,11 +18,22 @@ static const uint MAX_TC_MODE = 2;
 // window objects
 GLFWwindow*	window = nullptr;
 ivec2		window_size = ivec2(1280, 720); // initial window size
+headless_t	headless;	// offscreen rendering for a fixed number of frames or seconds
 
 //*************************************
 // OpenGL objects
 GLuint	program	= 0;	// ID holder for GPU program
 GLuint	vertex_array = 0;	// ID holder for vertex array object
+GLuint	empty_array = 0;	// vertex array without attributes for the procedural sphere
+program_uniforms	uniforms;	// active uniforms of the program
+
+// typed handles of the uniforms, resolved once after linking
+struct
+{
+	uniform<mat4>	model_matrix, view_projection_matrix, aspect_matrix;
+	uniform<uint>	tc_mode, vertex_format, sphere_slices, sphere_stacks;
+	uniform<int>	b_procedural;
+} u;
 
 //*************************************
 // global variables
@@ -26,13 +42,20 @@ uint	tc_mode = 0;	// To toggle colors
 bool	b_rotation = false;	// where rotating
 float	rotation_time_elapsed = 0.0f;	// only count the time of rotating
 float	time_checkpoint = 0.0f;	// starting point of elapsed time
+bool	b_stats = false;	// print GL calls per frame every second?
+bool	b_lod = true;		// choose the sphere resolution by its screen size?
+vertex_format	vformat = VERTEX_FLOAT;	// layout of the vertex buffer
+bool	b_procedural = false;	// generate the UV sphere from gl_VertexID without vertex and index buffers?
+uint	lod_level = 0;		// current level of the sphere
 #ifndef GL_ES_VERSION_2_0
 bool	b_wireframe = false;
 #endif
 
-// holder of vertices and indices of a unit sphere
-std::vector<vertex>	unit_sphere_vertices;
-std::vector<uint> indices;
+// holder of vertices and indices of the unit sphere levels
+sphere_lods	lods;
+
+// accumulated GL calls for the stats output
+struct { int frames=0, gl_calls=0, skipped=0; double triangles=0, t0=0; } perf;
 
 //*************************************
 void update()
@@ -47,17 +70,18 @@ void update()
 	};
 
 	// update uniform variables in vertex/fragment shaders
+	profile_zone zone("uniforms");
 	mat4 view_projection_matrix = { 0,1,0,0,0,0,1,0,-1,0,0,1,0,0,0,1 };
-	GLint uloc = glGetUniformLocation(program, "view_projection_matrix");
-	if (uloc > -1) glUniformMatrix4fv(uloc, 1, GL_TRUE, view_projection_matrix);
+	uniforms.set(u.view_projection_matrix, view_projection_matrix);
 
 	// update aspect matrix
-	uloc = glGetUniformLocation(program, "aspect_matrix");
-	if (uloc > -1) glUniformMatrix4fv(uloc, 1, GL_TRUE, aspect_matrix);
+	uniforms.set(u.aspect_matrix, aspect_matrix);
 
 	// set the texcoord mode : (tc.xy,0) or (tc.xxx) or (tc.yyy)
-	uloc = glGetUniformLocation(program, "tc_mode");
-	if (uloc > -1) glUniform1ui(uloc, tc_mode);
+	uniforms.set(u.tc_mode, tc_mode);
+
+	// decoding of the vertex attributes
+	uniforms.set(u.vertex_format, uint(vformat));
 }
 
 void render()
@@ -68,50 +92,77 @@ void render()
 	// notify GL that we use our own program
 	glUseProgram( program );
 	
-	// bind vertex array object
-	glBindVertexArray(vertex_array);
+	// bind vertex array object; the procedural sphere reads no attributes
+	glBindVertexArray(b_procedural ? empty_array : vertex_array);
 
 	// render vertices: trigger shader programs to process vertex data
 	// configure transformation parameters
-	if (b_rotation) rotation_time_elapsed += float(glfwGetTime()) - time_checkpoint;
-	time_checkpoint = float(glfwGetTime());
+	if (b_rotation) rotation_time_elapsed += float(app_time()) - time_checkpoint;
+	time_checkpoint = float(app_time());
 	float theta = rotation_time_elapsed * 0.5f;
 
 	// build the model matrix
 	mat4 model_matrix;
-
-	mat4 scale_matrix =
 	{
-		1, 0, 0, 0,
-		0, 1, 0, 0,
-		0, 0, 1, 0,
-		0, 0, 0, 1
-	};
+		profile_zone zone("matrices");
+		mat4 scale_matrix =
+		{
+			1, 0, 0, 0,
+			0, 1, 0, 0,
+			0, 0, 1, 0,
+			0, 0, 0, 1
+		};
 
-	mat4 rotation_matrix =
-	{
-		cos(theta), -sin(theta), 0, 0,
-		sin(theta), cos(theta), 0, 0,
-		0, 0, 1, 0,
-		0, 0, 0, 1
-	};
+		mat4 rotation_matrix =
+		{
+			cos(theta), -sin(theta), 0, 0,
+			sin(theta), cos(theta), 0, 0,
+			0, 0, 1, 0,
+			0, 0, 0, 1
+		};
 
-	mat4 translate_matrix =
-	{
-		1, 0, 0, 0,
-		0, 1, 0, 0,
-		0, 0, 1, 0,
-		0, 0, 0, 1
-	};
+		mat4 translate_matrix =
+		{
+			1, 0, 0, 0,
+			0, 1, 0, 0,
+			0, 0, 1, 0,
+			0, 0, 0, 1
+		};
 	
-	model_matrix = translate_matrix * rotation_matrix * scale_matrix;
+		model_matrix = translate_matrix * rotation_matrix * scale_matrix;
+	}
 
 	// update the uniform model matrix and render
-	glUniformMatrix4fv(glGetUniformLocation(program, "model_matrix"), 1, GL_TRUE, model_matrix);
-	glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, nullptr);
+	// level of detail from the screen radius; the aspect matrix fits the unit sphere to the shorter side
+	float screen_radius = min(window_size.x, window_size.y) * 0.5f;
+	uint l = lod_level = b_lod ? lods.select(screen_radius, lod_level) : lods.original;
+
+	{
+		gpu_zone zone("draw");
+		uniforms.set(u.model_matrix, model_matrix);
+		uniforms.set(u.b_procedural, int(b_procedural));
+		if (b_procedural) {
+			// the resolution is only a pair of uniforms; six vertices per quad as in the index buffer
+			uniforms.set(u.sphere_slices, lods.levels[l].slices);
+			uniforms.set(u.sphere_stacks, lods.levels[l].stacks);
+			glDrawArrays(GL_TRIANGLES, 0, lods.levels[l].slices * lods.levels[l].stacks * 6);
+		}
+		else glDrawElements(GL_TRIANGLES, lods.levels[l].index_count, lods.index_size() == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, lods.offset(l));
+		gl_count(4);	// clear, program, vertex array and draw
+	}
 
-	// swap front and back buffers, and display to screen
-	glfwSwapBuffers( window );
+	// GL calls of this frame
+	double t = app_time();
+	perf.frames++; perf.gl_calls += gl_calls().total(); perf.skipped += gl_calls().skipped; gl_calls() = {};
+	perf.triangles += b_procedural ? lods.levels[l].slices * lods.levels[l].stacks * 2 : lods.triangles(l);
+	if (t - perf.t0 >= 1.0) {
+		if (b_stats) printf("> %d GL calls/frame (%d uploads skipped), %.0f triangles\n", perf.gl_calls / perf.frames, perf.skipped / perf.frames, perf.triangles / perf.frames);
+		perf = {}; perf.t0 = t;
+	}
+
+	// swap front and back buffers, and display to screen; the headless FBO is never presented
+	profile_zone zone("swap");
+	if (!headless.b_enabled) glfwSwapBuffers( window );
 }
 
 void update_vertex_buffer(const std::vector<vertex>& vertices, uint N)
@@ -132,17 +183,18 @@ void update_vertex_buffer(const std::vector<vertex>& vertices, uint N)
 		// generation of vertex buffer: use vertices as it is
 		glGenBuffers(1, &vertex_buffer);
 		glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(vertex) * vertices.size(), &vertices[0], GL_STATIC_DRAW);
+		std::vector<unsigned char> packed = pack_vertices(vformat, vertices);
+		glBufferData(GL_ARRAY_BUFFER, packed.size(), packed.data(), GL_STATIC_DRAW);
 
 		// geneation of index buffer
 		glGenBuffers(1, &index_buffer);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint) * indices.size(), &indices[0], GL_STATIC_DRAW);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, lods.index_bytes(), lods.index_data(), GL_STATIC_DRAW);
 	}
 
 	// generate vertex array object, which is mandatory for OpenGL 3.3 and higher
 	if (vertex_array) glDeleteVertexArrays(1, &vertex_array);
-	vertex_array = cg_create_vertex_array(vertex_buffer, index_buffer);
+	vertex_array = create_vertex_array(vformat, vertex_buffer, index_buffer);
 	if (!vertex_array) { printf("%s(): failed to create vertex aray\n", __func__); return; }
 }
 
@@ -164,6 +216,12 @@ void print_help()
 #endif
 	printf("- press 'd' to toggle (tc.xy,0) > (tc.xxx) > (tc.yyy)\n");
 	printf("- press 'r' to rotate the sphere\n");
+	printf("- press 'l' to toggle screen-space level of detail of the sphere\n");
+	printf("- press 'm' to cycle uv sphere > icosphere > cube sphere\n");
+	printf("- press 'v' to cycle float > octahedral > 10:10:10:2 > position-only vertices\n");
+	printf("- press 'b' to toggle buffer-free procedural UV spheres\n");
+	printf("- press 'p' to toggle printing GL calls and triangles per frame\n");
+	printf("- press 'u' to toggle between cached and per-draw uniform lookups\n");
 	printf( "\n" );
 }
 
@@ -189,6 +247,32 @@ void keyboard( GLFWwindow* window, int key, int scancode, int action, int mods )
 			if (b_rotation) b_rotation = false;
 			else b_rotation = true;
 		}
+		else if (key == GLFW_KEY_L) {
+			b_lod = !b_lod;
+			printf("> using %s sphere\n", b_lod ? "level-of-detail" : "72x36");
+		}
+		else if (key == GLFW_KEY_M) {
+			lods = create_sphere_lods(sphere_kind((lods.kind + 1) % NUM_SPHERE_KINDS));
+			update_vertex_buffer(lods.vertices, 0);
+			lods.print_stats();
+		}
+		else if (key == GLFW_KEY_V) {
+			vformat = vertex_format((vformat + 1) % NUM_VERTEX_FORMATS);
+			update_vertex_buffer(lods.vertices, 0);
+			printf("> using %s vertices: %u bytes each, %.2f MB\n", vertex_format_names[vformat], vertex_stride(vformat), lods.vertices.size() * vertex_stride(vformat) / 1048576.0);
+		}
+		else if (key == GLFW_KEY_B) {
+			b_procedural = !b_procedural;
+			printf("> using %s\n", b_procedural ? "procedural UV spheres from gl_VertexID" : "vertex and index buffers");
+		}
+		else if (key == GLFW_KEY_P) {
+			b_stats = !b_stats;
+			printf("> %s stats\n", b_stats ? "printing" : "hiding");
+		}
+		else if (key == GLFW_KEY_U) {
+			uniforms.b_bypass = !uniforms.b_bypass;
+			printf("> using %s uniforms\n", uniforms.b_bypass ? "per-draw lookups of" : "cached");
+		}
 	}
 }
 
@@ -216,7 +300,10 @@ bool user_init()
 	glEnable( GL_DEPTH_TEST );								// turn on depth tests
 
 	// create vertex buffer; called again when index buffering mode is toggled
-	update_vertex_buffer(unit_sphere_vertices,0);
+	update_vertex_buffer(lods.vertices,0);
+
+	// attribute-less vertex array, still required by the core profile
+	glGenVertexArrays(1, &empty_array);
 
 	return true;
 }
@@ -227,62 +314,62 @@ void user_finalize()
 
 int main( int argc, char* argv[] )
 {
-	float phi = 0.0f;
-	float theta = PI;
-	vertex vertex;
-
-	// creating vertices
-	for (int i = 0; i <= 72; i++) {
-		for (int j = 0; j <= 36; j++) {
-			//printf("phi: %f , theta: %f\n", phi, theta);
-			vertex.pos = vec3(sin(theta)*cos(phi),sin(theta)*sin(phi),cos(theta));
-			vertex.norm = vec3(sin(theta) * cos(phi), sin(theta) * sin(phi), cos(theta));
-			vertex.tex = vec2(phi/2/PI, 1-theta/PI);
-			unit_sphere_vertices.emplace_back(vertex);
-			theta -= PI / 36;
-		}
-		theta = PI;
-		phi += 2 * PI / 72;
-	}
-
-	// creating indices
-	for (int i = 0; i < 72; i++) {
-		for (int j = 0; j < 36; j++) {
-			indices.emplace_back(37 * i + j);
-			indices.emplace_back(37 * (i + 1) + j);
-			indices.emplace_back(37 * (i + 1) + (j + 1));
-
-			indices.emplace_back(37 * i + j);
-			indices.emplace_back(37 * (i + 1) + (j + 1));
-			indices.emplace_back(37 * i + (j + 1));
-		}
+	// unit sphere levels from 8x4 to 256x128 in one buffer
+	lods = create_sphere_lods();
+	lods.print_stats();
+
+	// create window and initialize OpenGL extensions, or an offscreen context for "--headless [frames]"
+	headless.size = window_size; headless.parse( argc, argv );
+	prof().parse( argc, argv );	// "--profile [prefix]" for the zones and their trace
+	if(headless.b_enabled){ window_size = headless.size; if(!headless.create( window_name, window )){ glfwTerminate(); return 1; } }
+	else
+	{
+		if(!(window = cg_create_window( window_name, window_size.x, window_size.y ))){ glfwTerminate(); return 1; }
+		if(!cg_init_extensions( window )){ glfwTerminate(); return 1; }	// version and extensions
 	}
 
-	// create window and initialize OpenGL extensions
-	if(!(window = cg_create_window( window_name, window_size.x, window_size.y ))){ glfwTerminate(); return 1; }
-	if(!cg_init_extensions( window )){ glfwTerminate(); return 1; }	// version and extensions
-
 	// initializations and validations
 	if(!(program=cg_create_program( vert_shader_path, frag_shader_path ))){ glfwTerminate(); return 1; }	// create and compile shaders/program
+	uniforms.reflect( program );
+	glUseProgram( program );	// uniforms are set in update() before render() binds the program
+	u.model_matrix = uniforms.get<mat4>( "model_matrix" );
+	u.view_projection_matrix = uniforms.get<mat4>( "view_projection_matrix" );
+	u.aspect_matrix = uniforms.get<mat4>( "aspect_matrix" );
+	u.tc_mode = uniforms.get<uint>( "tc_mode" );
+	u.vertex_format = uniforms.get<uint>( "vertex_format" );
+	u.sphere_slices = uniforms.get<uint>( "sphere_slices" );
+	u.sphere_stacks = uniforms.get<uint>( "sphere_stacks" );
+	u.b_procedural = uniforms.get<int>( "b_procedural" );
 	if(!user_init()){ printf( "Failed to user_init()\n" ); glfwTerminate(); return 1; }					// user initialization
+	gpu_prof().create();	// timer queries when profiling
 
 	// register event callbacks
-	glfwSetWindowSizeCallback( window, reshape );	// callback for window resizing events
-    glfwSetKeyCallback( window, keyboard );			// callback for keyboard events
-	glfwSetMouseButtonCallback( window, mouse );	// callback for mouse click inputs
-	glfwSetCursorPosCallback( window, motion );		// callback for mouse movement
+	if(window)
+	{
+		glfwSetWindowSizeCallback( window, reshape );	// callback for window resizing events
+		glfwSetKeyCallback( window, keyboard );			// callback for keyboard events
+		glfwSetMouseButtonCallback( window, mouse );	// callback for mouse click inputs
+		glfwSetCursorPosCallback( window, motion );		// callback for mouse movement
+	}
 
 	// enters rendering/event loop
-	for( frame=0; !glfwWindowShouldClose(window); frame++ )
+	headless.start();	// setup is not part of the measured frames
+	for( frame=0; headless.b_enabled ? headless.running(frame) : !glfwWindowShouldClose(window); frame++ )
 	{
-		glfwPollEvents();	// polling and processing of events
+		prof().begin_frame( frame ); gpu_prof().begin_frame( frame );
+		if(!headless.b_enabled){ profile_zone zone( "input" ); glfwPollEvents(); }	// polling and processing of events
 		update();			// per-frame update
 		render();			// per-frame render
+		if(headless.b_enabled) headless.end_frame();
+		gpu_prof().end_frame(); prof().end_frame();
 	}
 
 	// normal termination
+	gpu_prof().destroy();
+	prof().finish();	// frame-time percentiles and the trace files
 	user_finalize();
-	cg_destroy_window(window);
+	headless.finish();	// stats and the last frame, then the offscreen context
+	if(window) cg_destroy_window(window);
 
 	return 0;
 }
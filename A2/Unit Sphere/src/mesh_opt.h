@@ -0,0 +1,136 @@
+#pragma once
+#ifndef __MESH_OPT_H__
+#define __MESH_OPT_H__
+#include <algorithm>
+#include <vector>
+#include "cgmath.h"		// no GL or GLFW dependency below this point
+
+//*************************************
+// post-transform cache efficiency of an index buffer, simulated with a FIFO cache
+struct mesh_stats
+{
+	float	acmr = 0;	// average cache miss ratio: transformed vertices per triangle, 0.5 at best for large meshes
+	float	atvr = 0;	// average transformed vertex ratio: transformed vertices per vertex, 1 at best
+};
+
+static const uint MESH_FIFO_SIZE = 16;	// conservative size of post-transform caches
+
+inline mesh_stats analyze_vertex_cache( const uint* indices, size_t index_count, size_t vertex_count, uint cache_size=MESH_FIFO_SIZE )
+{
+	mesh_stats s; if(!index_count||!vertex_count) return s;
+	std::vector<uint> stamp( vertex_count, 0 );	// time at which the vertex entered the cache
+	uint time = cache_size+1, misses = 0;
+	for( size_t k=0; k < index_count; k++ )
+	{
+		uint v = indices[k];
+		if(time-stamp[v] > cache_size){ stamp[v] = time++; misses++; }
+	}
+	s.acmr = misses/float(index_count/3);
+	s.atvr = misses/float(vertex_count);
+	return s;
+}
+
+//*************************************
+// triangle order for the post-transform cache (Forsyth, "Linear-speed vertex cache optimisation")
+// each vertex is scored by its position in a simulated LRU cache and by its remaining valence;
+// the next triangle is the best-scored one among those touching the cache
+static const uint FORSYTH_CACHE_SIZE = 32;
+
+inline float forsyth_score( int cache_position, uint valence )
+{
+	static const float cache_decay = 1.5f, last_triangle = 0.75f, valence_scale = 2.0f, valence_power = 0.5f;
+	if(valence==0) return -1.0f;	// no triangles left to emit
+	float score = 0.0f;
+	if(cache_position>=0)
+	{
+		if(cache_position<3) score = last_triangle;	// vertices of the last triangle, fixed so that strips do not win by default
+		else score = pow( 1.0f-(cache_position-3)/float(FORSYTH_CACHE_SIZE-3), cache_decay );
+	}
+	return score+valence_scale*pow(float(valence),-valence_power);
+}
+
+inline void optimize_vertex_cache( uint* indices, size_t index_count, size_t vertex_count )
+{
+	size_t triangle_count = index_count/3; if(!triangle_count) return;
+
+	// triangles of each vertex in a flat adjacency list
+	std::vector<uint> valence( vertex_count, 0 ), offset( vertex_count+1, 0 ), adjacency( index_count );
+	for( size_t k=0; k < index_count; k++ ) valence[indices[k]]++;
+	for( size_t v=0; v < vertex_count; v++ ) offset[v+1] = offset[v]+valence[v];
+	std::vector<uint> fill( offset.begin(), offset.end()-1 );
+	for( size_t k=0; k < index_count; k++ ) adjacency[fill[indices[k]]++] = uint(k/3);
+
+	std::vector<int> position( vertex_count, -1 );
+	std::vector<float> vertex_score( vertex_count ), triangle_score( triangle_count, 0.0f );
+	std::vector<char> b_emitted( triangle_count, 0 );
+	for( size_t v=0; v < vertex_count; v++ ) vertex_score[v] = forsyth_score( -1, valence[v] );
+	for( size_t k=0; k < index_count; k++ ) triangle_score[k/3] += vertex_score[indices[k]];
+
+	std::vector<uint> output; output.reserve( index_count );
+	std::vector<uint> cache, next_cache; cache.reserve( FORSYTH_CACHE_SIZE+3 ); next_cache.reserve( FORSYTH_CACHE_SIZE+3 );
+	size_t best = 0, scan = 0;		// scan: first triangle that may not have been emitted yet
+	for( size_t emitted=0; emitted < triangle_count; emitted++ )
+	{
+		if(best==size_t(-1))	// the cache has no live triangles: take the next one in the input order
+		{
+			while( b_emitted[scan] ) scan++;
+			best = scan;
+		}
+
+		// emit the triangle, remove it from the adjacency of its vertices, and move them to the front of the cache
+		const uint* t = indices+best*3;
+		b_emitted[best] = 1;
+		next_cache.assign( t, t+3 );
+		for( int c=0; c < 3; c++ )
+		{
+			uint v = t[c]; output.push_back(v);
+			uint* a = &adjacency[offset[v]], *last = a+valence[v]-1;
+			std::iter_swap( std::find(a,last+1,uint(best)), last );
+			valence[v]--;
+		}
+		for( uint v : cache ) if(v!=t[0]&&v!=t[1]&&v!=t[2]) next_cache.push_back(v);
+		std::swap( cache, next_cache );
+
+		// rescore the vertices in the cache and those that just fell out of it, then their triangles
+		for( size_t c=0; c < next_cache.size(); c++ ) position[next_cache[c]] = -1;
+		for( size_t c=0; c < cache.size(); c++ ) position[cache[c]] = c<FORSYTH_CACHE_SIZE ? int(c) : -1;
+		best = size_t(-1); float best_score = -1.0f;
+		for( uint v : next_cache ) if(position[v]<0)
+		{
+			float s = forsyth_score( -1, valence[v] ), d = s-vertex_score[v]; vertex_score[v] = s;
+			for( uint i=offset[v], e=offset[v]+valence[v]; i < e; i++ ) triangle_score[adjacency[i]] += d;
+		}
+		for( size_t c=0; c < cache.size(); c++ )
+		{
+			uint v = cache[c];
+			float s = forsyth_score( position[v], valence[v] ), d = s-vertex_score[v]; vertex_score[v] = s;
+			for( uint i=offset[v], e=offset[v]+valence[v]; i < e; i++ ) triangle_score[adjacency[i]] += d;
+		}
+		if(cache.size()>FORSYTH_CACHE_SIZE) cache.resize( FORSYTH_CACHE_SIZE );
+		for( uint v : cache ) for( uint i=offset[v], e=offset[v]+valence[v]; i < e; i++ )
+		{
+			uint tri = adjacency[i];
+			if(triangle_score[tri]>best_score){ best_score = triangle_score[tri]; best = tri; }
+		}
+	}
+	std::copy( output.begin(), output.end(), indices );
+}
+
+//*************************************
+// renumber the vertices in the order of their first use, so that vertex fetches walk memory forward
+// unreferenced vertices go to the end; T is any vertex type
+template <class T> void optimize_vertex_fetch( std::vector<T>& vertices, uint* indices, size_t index_count )
+{
+	std::vector<uint> remap( vertices.size(), uint(-1) );
+	std::vector<T> fetched; fetched.reserve( vertices.size() );
+	for( size_t k=0; k < index_count; k++ )
+	{
+		uint& r = remap[indices[k]];
+		if(r==uint(-1)){ r = uint(fetched.size()); fetched.push_back( vertices[indices[k]] ); }
+		indices[k] = r;
+	}
+	for( size_t v=0; v < vertices.size(); v++ ) if(remap[v]==uint(-1)) fetched.push_back( vertices[v] );
+	vertices.swap( fetched );
+}
+
+#endif // __MESH_OPT_H__
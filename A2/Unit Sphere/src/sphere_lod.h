@@ -0,0 +1,89 @@
+#pragma once
+#ifndef __SPHERE_LOD_H__
+#define __SPHERE_LOD_H__
+#include <stdio.h>
+#include <vector>
+#include "cgmath.h"
+#include "cgut.h"		// vertex
+#include "mesh.h"
+
+//*************************************
+// chain of sphere meshes packed into one vertex/index buffer; indices are absolute
+struct sphere_lods
+{
+	struct level
+	{
+		uint	slices, stacks;		// subdivisions along phi and theta; slices is the equivalent for other kinds
+		uint	first_index;		// offset in indices
+		uint	index_count;
+		uint	vertex_count;
+		mesh_stats	naive, optimized;	// post-transform cache efficiency of the level
+	};
+
+	std::vector<level>	levels;		// coarse to fine
+	std::vector<vertex>	vertices;
+	std::vector<uint>	indices;
+	std::vector<unsigned short>	indices16;	// copy of indices when every vertex fits in 16 bits; empty otherwise
+	sphere_kind			kind = UV_SPHERE;
+	uint				original = 0;	// level of the 72x36 sphere of the original code
+
+	uint		index_size() const { return indices16.empty() ? sizeof(uint) : sizeof(unsigned short); }
+	const void*	index_data() const { return indices16.empty() ? (const void*)indices.data() : (const void*)indices16.data(); }
+	size_t		index_bytes() const { return indices.size()*index_size(); }
+	const void*	offset( uint l ) const { return (const void*)(size_t(levels[l].first_index)*index_size()); }
+	uint		triangles( uint l ) const { return levels[l].index_count/3; }
+	void		add( uint slices, uint stacks );
+	uint		select( float screen_radius, uint current, float edge_pixels=8.0f ) const;
+	void		print_stats() const;
+};
+
+// appends a unit sphere of about the given density, shared through the mesh cache;
+// icospheres get slices/5 and cube spheres slices/4 subdivisions, so that their silhouettes have about slices edges
+inline void sphere_lods::add( uint slices, uint stacks )
+{
+	auto m = kind==UV_SPHERE ? get_sphere_mesh( kind, slices, stacks ) : get_sphere_mesh( kind, std::max(1u,slices/(kind==ICOSPHERE?5:4)) );
+	uint base = uint(vertices.size());
+	levels.push_back( { slices, stacks, uint(indices.size()), uint(m->indices.size()), uint(m->vertices.size()), m->naive, m->optimized } );
+	vertices.insert( vertices.end(), m->vertices.begin(), m->vertices.end() );
+	for( uint i : m->indices ) indices.push_back( base+i );
+}
+
+//*************************************
+// finest level needed for a sphere of the given screen radius in pixels, so that
+// its silhouette edges are about edge_pixels long; hysteresis keeps the current level
+// until the radius leaves a 25% band around the switching point, which avoids popping
+inline uint sphere_lods::select( float screen_radius, uint current, float edge_pixels ) const
+{
+	float needed = 2*PI*screen_radius/edge_pixels;	// slices of the silhouette
+	uint l = std::min( current, uint(levels.size())-1 );
+	while( l+1 < levels.size() && needed > levels[l].slices*1.25f ) l++;
+	while( l > 0 && needed < levels[l-1].slices*0.75f ) l--;
+	return l;
+}
+
+// size and post-transform cache efficiency (FIFO of MESH_FIFO_SIZE) of every level
+inline void sphere_lods::print_stats() const
+{
+	printf( "> %s levels with %d-bit indices\n", sphere_kind_names[kind], int(index_size()*8) );
+	for( auto& l : levels )
+		printf( "  %3ux%-3u %6u vertices %7u triangles: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", l.slices, l.stacks, l.vertex_count, l.index_count/3, l.naive.acmr, l.optimized.acmr, l.naive.atvr, l.optimized.atvr );
+}
+
+// 8x4 up to 256x128, including the original 72x36, or their counterparts of another kind
+inline sphere_lods create_sphere_lods( sphere_kind kind=UV_SPHERE )
+{
+	sphere_lods lods;
+	lods.kind = kind;
+	static const uint slices[] = { 8, 16, 32, 72, 128, 256 };
+	for( uint s : slices )
+	{
+		if(s==72) lods.original = uint(lods.levels.size());
+		lods.add( s, s/2 );
+	}
+
+	// half the index bandwidth when all the levels together have at most 65536 vertices
+	if(lods.vertices.size()<=65536) lods.indices16.assign( lods.indices.begin(), lods.indices.end() );
+	return lods;
+}
+
+#endif // __SPHERE_LOD_H__
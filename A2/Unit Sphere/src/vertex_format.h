@@ -0,0 +1,155 @@
+#pragma once
+#ifndef __VERTEX_FORMAT_H__
+#define __VERTEX_FORMAT_H__
+#include <stddef.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "cgmath.h"
+#include "cgut.h"		// vertex, cg_create_vertex_array()
+
+//*************************************
+// compact alternatives to the 32-byte float vertex of cgut for meshes within [-1,1]^3
+// attribute locations stay 0 (position), 1 (normal), 2 (texcoord); shaders decode by the vertex_format uniform
+enum vertex_format { VERTEX_FLOAT=0, VERTEX_OCT, VERTEX_PACKED, VERTEX_POSITION, NUM_VERTEX_FORMATS };
+static const char* vertex_format_names[] = { "float", "octahedral", "10:10:10:2", "position-only" };
+
+struct vertex_oct		// 16 bytes
+{
+	short			pos[4];		// snorm16 xyz and padding
+	short			norm[2];	// snorm16 octahedral encoding
+	unsigned short	tex[2];		// half floats
+};
+
+struct vertex_packed	// 16 bytes
+{
+	short			pos[4];		// snorm16 xyz and padding
+	uint			norm;		// GL_INT_2_10_10_10_REV: snorm10 xyz, w unused
+	unsigned short	tex[2];		// half floats
+};
+
+inline uint vertex_stride( vertex_format f ){ static const uint s[] = { sizeof(vertex), sizeof(vertex_oct), sizeof(vertex_packed), sizeof(vec3) }; return s[f]; }
+
+//*************************************
+// scalar conversions; all round to nearest
+inline unsigned short float_to_half( float f )
+{
+	uint x; memcpy( &x, &f, 4 );
+	uint sign = (x>>16)&0x8000, m = x&0x7fffff; int e = int((x>>23)&0xff)-127+15;
+	if(e>=31) return (unsigned short)(sign|0x7c00);
+	if(e<=0)	// subnormal or zero
+	{
+		if(e<-10) return (unsigned short)(sign);
+		m |= 0x800000; uint shift = uint(14-e);
+		return (unsigned short)(sign|((m>>shift)+((m>>(shift-1))&1)));
+	}
+	return (unsigned short)(sign|((uint(e)<<10|m>>13)+((m>>12)&1)));	// a carry rounds up into the exponent
+}
+
+inline float half_to_float( unsigned short h )
+{
+	uint sign = uint(h&0x8000)<<16, e = (h>>10)&0x1f, m = h&0x3ff, x;
+	if(e==0){ float f = m/16777216.0f; return sign ? -f : f; }
+	x = e==31 ? sign|0x7f800000|(m<<13) : sign|((e-15+127)<<23)|(m<<13);
+	float f; memcpy( &f, &x, 4 ); return f;
+}
+
+inline short	float_to_snorm16( float f ){ return short(floor(std::max(-1.0f,std::min(1.0f,f))*32767.0f+0.5f)); }
+inline float	snorm16_to_float( short s ){ return std::max(-1.0f,s/32767.0f); }
+
+// octahedral map of a unit vector to [-1,1]^2: project to |x|+|y|+|z|=1 and fold the lower half over the diagonals
+inline vec2 oct_encode( vec3 n )
+{
+	n = n*(1.0f/(fabs(n.x)+fabs(n.y)+fabs(n.z)));
+	if(n.z>=0) return vec2(n.x,n.y);
+	return vec2( (1-fabs(n.y))*(n.x>=0?1:-1), (1-fabs(n.x))*(n.y>=0?1:-1) );
+}
+
+inline vec3 oct_decode( vec2 e )
+{
+	vec3 n( e.x, e.y, 1-fabs(e.x)-fabs(e.y) );
+	float t = std::max(-n.z,0.0f);
+	n.x += n.x>=0 ? -t : t; n.y += n.y>=0 ? -t : t;
+	return n.normalize();
+}
+
+inline uint pack_1010102( vec3 n )
+{
+	auto s10 = []( float f ){ return uint(int(floor(std::max(-1.0f,std::min(1.0f,f))*511.0f+0.5f)))&0x3ff; };
+	return s10(n.x)|s10(n.y)<<10|s10(n.z)<<20;
+}
+
+inline vec3 unpack_1010102( uint p )
+{
+	auto f10 = []( uint b ){ int v = int(b<<22)>>22; return std::max(-1.0f,v/511.0f); };
+	return vec3( f10(p), f10(p>>10), f10(p>>20) );
+}
+
+//*************************************
+// vertex buffer contents of the given format; the position-only stream leaves normals and
+// texture coordinates to the shader, which is exact for spheres and flat circles
+inline std::vector<unsigned char> pack_vertices( vertex_format f, const std::vector<vertex>& vertices )
+{
+	std::vector<unsigned char> buffer( vertices.size()*size_t(vertex_stride(f)) );
+	unsigned char* p = buffer.data();
+	if(f==VERTEX_FLOAT) memcpy( p, vertices.data(), buffer.size() );
+	else if(f==VERTEX_POSITION) for( size_t k=0; k < vertices.size(); k++ ) memcpy( p+k*sizeof(vec3), &vertices[k].pos, sizeof(vec3) );
+	else
+	{
+		for( size_t k=0; k < vertices.size(); k++ )
+		{
+			const vertex& v = vertices[k];
+			vertex_packed q = { { float_to_snorm16(v.pos.x), float_to_snorm16(v.pos.y), float_to_snorm16(v.pos.z), 0 }, 0, { float_to_half(v.tex.x), float_to_half(v.tex.y) } };
+			if(f==VERTEX_OCT)
+			{
+				vec2 e = oct_encode(v.norm);
+				vertex_oct o = { { q.pos[0], q.pos[1], q.pos[2], 0 }, { float_to_snorm16(e.x), float_to_snorm16(e.y) }, { q.tex[0], q.tex[1] } };
+				memcpy( p+k*sizeof(o), &o, sizeof(o) );
+			}
+			else { q.norm = pack_1010102(v.norm); memcpy( p+k*sizeof(q), &q, sizeof(q) ); }
+		}
+	}
+	return buffer;
+}
+
+// CPU decoding of one packed vertex, the same as the shaders do; used to measure the quantization error
+inline vertex unpack_vertex( vertex_format f, const unsigned char* buffer, size_t k )
+{
+	vertex v;
+	if(f==VERTEX_FLOAT){ memcpy( &v, buffer+k*sizeof(vertex), sizeof(vertex) ); return v; }
+	if(f==VERTEX_POSITION){ memcpy( &v.pos, buffer+k*sizeof(vec3), sizeof(vec3) ); v.norm = v.pos; v.tex = vec2(0); return v; }
+	vertex_packed q; memcpy( &q, buffer+k*sizeof(q), sizeof(q) );	// vertex_oct has the same layout up to norm
+	v.pos = vec3( snorm16_to_float(q.pos[0]), snorm16_to_float(q.pos[1]), snorm16_to_float(q.pos[2]) );
+	v.tex = vec2( half_to_float(q.tex[0]), half_to_float(q.tex[1]) );
+	if(f==VERTEX_OCT){ short e[2]; memcpy( e, &q.norm, sizeof(e) ); v.norm = oct_decode( vec2(snorm16_to_float(e[0]),snorm16_to_float(e[1])) ); }
+	else v.norm = unpack_1010102(q.norm);
+	return v;
+}
+
+//*************************************
+// vertex array of a buffer created from pack_vertices(); attributes absent from the format read (0,0,0,1)
+inline GLuint create_vertex_array( vertex_format f, GLuint vertex_buffer, GLuint index_buffer=0 )
+{
+	if(f==VERTEX_FLOAT) return cg_create_vertex_array( vertex_buffer, index_buffer );
+
+	GLuint va; glGenVertexArrays( 1, &va );
+	glBindVertexArray( va );
+	glBindBuffer( GL_ARRAY_BUFFER, vertex_buffer );
+	GLsizei stride = GLsizei(vertex_stride(f));
+	glEnableVertexAttribArray( 0 );
+	if(f==VERTEX_POSITION) glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, stride, (const void*) 0 );
+	else
+	{
+		glVertexAttribPointer( 0, 3, GL_SHORT, GL_TRUE, stride, (const void*) offsetof(vertex_packed,pos) );
+		glEnableVertexAttribArray( 1 );
+		if(f==VERTEX_OCT) glVertexAttribPointer( 1, 2, GL_SHORT, GL_TRUE, stride, (const void*) offsetof(vertex_oct,norm) );
+		else glVertexAttribPointer( 1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (const void*) offsetof(vertex_packed,norm) );
+		glEnableVertexAttribArray( 2 );
+		glVertexAttribPointer( 2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (const void*) offsetof(vertex_packed,tex) );
+	}
+	if(index_buffer) glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, index_buffer );
+	glBindVertexArray( 0 );
+	return va;
+}
+
+#endif // __VERTEX_FORMAT_H__
@@ -0,0 +1,45 @@
+#ifdef GL_ES
+	#ifndef GL_FRAGMENT_PRECISION_HIGH	// highp may not be defined
+		#define highp mediump
+	#endif
+	precision highp float; // default precision needs to be defined
+#endif
+
+// input from vertex shader
+in vec3 view_pos;
+flat in vec4 view_sphere;
+flat in float body_spin;
+
+// per-frame camera shared by all programs
+layout(std140, row_major) uniform camera
+{
+	mat4 view_matrix;
+	mat4 projection_matrix;
+	mat4 view_projection_matrix;
+};
+
+// the only output variable
+out vec4 fragColor;
+
+const float PI = 3.141592653589793;
+
+void main()
+{
+	// nearest intersection of the eye ray with the sphere
+	vec3 dir = normalize(view_pos), c = view_sphere.xyz;
+	float b = dot(dir,c), disc = b*b-dot(c,c)+view_sphere.w*view_sphere.w;
+	if(disc<0.0) discard;
+	vec3 hit = dir*(b-sqrt(disc));
+	vec3 n = (hit-c)/view_sphere.w;	// view-space normal
+
+	// depth of the hit point instead of the quad, so that impostors and meshes intersect correctly
+	vec4 clip = projection_matrix*vec4(hit,1);
+	gl_FragDepth = 0.5*(gl_DepthRange.diff*clip.z/clip.w+gl_DepthRange.near+gl_DepthRange.far);
+
+	// texcoords of the mesh: back to world space, then undo the spin of the body
+	vec3 o = transpose(mat3(view_matrix))*n;
+	float cs = cos(body_spin), sn = sin(body_spin);
+	o = vec3(cs*o.x+sn*o.y,-sn*o.x+cs*o.y,o.z);
+	vec2 tc = vec2(atan(o.y,o.x)/(2.0*PI)+(o.y<0.0?1.0:0.0),1.0-acos(clamp(o.z,-1.0,1.0))/PI);
+	fragColor = vec4(tc.xy,0,1);
+}
\ No newline at end of file
@@ -0,0 +1,33 @@
+// per-instance sphere; the quad corners come from gl_VertexID
+layout(location=0) in vec4 sphere;	// world-space center and radius
+layout(location=1) in float spin;	// rotation of the body about its z axis
+
+// per-frame camera shared by all programs; uploaded row-major from cgmath
+layout(std140, row_major) uniform camera
+{
+	mat4 view_matrix;
+	mat4 projection_matrix;
+	mat4 view_projection_matrix;
+};
+
+out vec3 view_pos;				// view-space point on the quad
+flat out vec4 view_sphere;		// view-space center and radius
+flat out float body_spin;
+
+void main()
+{
+	vec3 c = (view_matrix*vec4(sphere.xyz,1)).xyz;
+	float r = sphere.w, d = length(c);
+	view_sphere = vec4(c,r);
+	body_spin = spin;
+
+	// no impostor when the eye is inside the sphere: a degenerate quad behind the near plane
+	if(d<=r){ view_pos = vec3(0); gl_Position = vec4(0,0,-2,1); return; }
+
+	// quad through the center, perpendicular to the ray toward it, whose inscribed circle
+	// is the cross section of the cone of rays tangent to the sphere; counter-clockwise on screen
+	vec3 w = c/d, u = normalize(cross(w,abs(w.y)<0.99?vec3(0,1,0):vec3(1,0,0))), v = cross(u,w);
+	vec2 corner = vec2(float(gl_VertexID&1),float(gl_VertexID>>1))*2.0-1.0;
+	view_pos = c+(u*corner.x+v*corner.y)*(r*d/sqrt(d*d-r*r));
+	gl_Position = projection_matrix*vec4(view_pos,1);
+}
\ No newline at end of file
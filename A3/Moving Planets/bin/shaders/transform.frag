@@ -8,11 +8,19 @@
 // input from vertex shader
 in vec3 norm;
 in vec2 tc;
+in vec3 sphere_pos;
+
+uniform uint vertex_format;	// 3: position only, where texcoords are derived per fragment
 
 // the only output variable
 out vec4 fragColor;
 
+const float PI = 3.141592653589793;
+
 void main()
 {
-	fragColor = vec4(tc.xy,0,1);
+	// per fragment rather than per vertex, so that the seam column does not interpolate from 1 back to 0
+	vec3 p = normalize(sphere_pos);
+	vec2 t = vertex_format==3u ? vec2(atan(p.y,p.x)/(2.0*PI)+(p.y<0.0?1.0:0.0),1.0-acos(clamp(p.z,-1.0,1.0))/PI) : tc;
+	fragColor = vec4(t.xy,0,1);
 }
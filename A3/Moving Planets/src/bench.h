@@ -0,0 +1,217 @@
+#pragma once
+#ifndef __BENCH_H__
+#define __BENCH_H__
+#include <chrono>
+#include "planet.h"
+#include "rng.h"
+#include "frustum.h"
+#include "sphere_lod.h"
+#include "vertex_format.h"
+
+//*************************************
+// synthetic system of about n bodies: the sun, planets on rings, and three moons per planet
+inline std::vector<planet_t> create_bodies( uint n )
+{
+	std::vector<planet_t> bodies = { { vec3(0.0f), 8.0f, 0.0f, 0.0f, 0.5f, 0.0f, -1 } };
+	for (uint k = 0; bodies.size() < n; k++) {
+		int p = int(bodies.size());
+		float d = 14.0f + 0.05f * k;
+		bodies.push_back({ vec3(d * cos(k * 2.4f), d * sin(k * 2.4f), 0.0f), 1.0f, 0.0f, 0.0f, 0.5f + (k % 7) * 0.1f, 1.0f / sqrt(d), 0 });
+		for (uint m = 0; m < 3 && bodies.size() < n; m++)
+			bodies.push_back({ vec3(2.0f + m, 0.0f, 0.0f), 0.3f, 0.0f, 0.0f, 1.0f, 2.0f + m, p });
+	}
+	return bodies;
+}
+
+//*************************************
+// transform update: "--bench-scene [bodies]"
+// the legacy path is the original per-frame rebuild of planet_t::update(), which has no hierarchy
+inline void run_scene_benchmark( uint n )
+{
+	auto bodies = create_bodies(n);
+	auto scene = create_scene(bodies);
+	const int frames = 200;
+	float t = 0.0f;
+
+	auto ms_per_frame = [&]( auto frame )
+	{
+		auto t0 = std::chrono::high_resolution_clock::now();
+		for (int f = 0; f < frames; f++) { t += 1 / 60.0f; frame(); }
+		auto t1 = std::chrono::high_resolution_clock::now();
+		return std::chrono::duration<double, std::milli>(t1 - t0).count() / frames;
+	};
+
+	double legacy = ms_per_frame([&]() {
+		for (auto& b : bodies) { b.rotation_theta = b.rotation_speed * t; b.revolution_theta = b.revolution_speed * t; b.update(); }
+	});
+	double moving = ms_per_frame([&]() {
+		for (int k = 0; k < int(bodies.size()); k++) { scene.set_rotation(k, bodies[k].rotation_speed * t); scene.set_revolution(k, bodies[k].revolution_speed * t); }
+		scene.update();
+	});
+	uint moving_updated = scene.updated;
+
+	// only the moons move, e.g., while the planets are paused
+	double moons = ms_per_frame([&]() {
+		for (int k = 0; k < int(bodies.size()); k++) if (bodies[k].parent > 0) { scene.set_rotation(k, bodies[k].rotation_speed * t); scene.set_revolution(k, bodies[k].revolution_speed * t); }
+		scene.update();
+	});
+
+	printf("%zu bodies\n", bodies.size());
+	printf("%16s %12s %10s\n", "path", "ms/frame", "updated");
+	printf("%16s %12.4f %10zu\n", "legacy", legacy, bodies.size());
+	printf("%16s %12.4f %10u\n", "scene", moving, moving_updated);
+	printf("%16s %12.4f %10u\n", "scene-moons", moons, scene.updated);
+}
+
+//*************************************
+// closed-form orbits: "--bench-kepler [bodies]"
+// evaluation costs the same at any time; the residual of Kepler's equation shows the solver accuracy
+inline void run_kepler_benchmark( uint n )
+{
+	kepler_orbits orbits;
+	pcg32 rng(1234);
+	for (uint k = 0; k < n; k++)
+		orbits.push_back(rng.uniform(5.0f, 60.0f), rng.uniform(0.0f, 0.9f), rng.uniform(0.0f, 2 * PI), rng.uniform(0.0f, 2 * PI), rng.uniform(0.1f, 2.0f));
+
+	printf("%u orbits\n", n);
+	printf("%14s %12s %14s\n", "time (s)", "ns/body", "max residual");
+	for (double t : { 10.0, 3.6e3 * 24, 3.6e3 * 24 * 365 * 10, 1e12 }) {
+		const int reps = 20;
+		auto t0 = std::chrono::high_resolution_clock::now();
+		for (int r = 0; r < reps; r++) orbits.evaluate(t + r);
+		auto t1 = std::chrono::high_resolution_clock::now();
+		double worst = 0;
+		for (uint k = 0; k < n; k++) worst = std::max(worst, fabs(orbits.E[k] - orbits.e[k] * sin(orbits.E[k]) - orbits.M[k]));
+		printf("%14.4g %12.1f %14.2e\n", t, std::chrono::duration<double, std::nano>(t1 - t0).count() / reps / n, worst);
+	}
+}
+
+//*************************************
+// frustum culling: "--bench-cull [bodies]"
+// random bodies in a 1000-unit cube seen by the default camera of main.cpp
+inline void run_cull_benchmark( uint n )
+{
+	pcg32 rng(1234);
+	std::vector<float> x(n), y(n), z(n), r(n);
+	for (uint k = 0; k < n; k++) { x[k] = rng.uniform(-500, 500); y[k] = rng.uniform(-500, 500); z[k] = rng.uniform(-500, 500); r[k] = rng.uniform(0.5f, 3.0f); }
+	mat4 view = mat4::look_at(vec3(0, 70, 0), vec3(0, 0, 0), vec3(0, 0, 1));
+	mat4 projection = mat4::perspective(PI / 4.0f, 16 / 9.0f, 1.0f, 1000.0f);
+	frustum f = make_frustum(projection * view);
+
+	std::vector<uint> visible;
+	const int reps = 50;
+	auto t0 = std::chrono::high_resolution_clock::now();
+	for (int k = 0; k < reps; k++) cull_spheres(f, x.data(), y.data(), z.data(), r.data(), n, visible);
+	auto t1 = std::chrono::high_resolution_clock::now();
+	printf("%u bodies: %zu visible (%.1f%%), %.2f ns/body\n", n, visible.size(), 100.0 * visible.size() / n, std::chrono::duration<double, std::nano>(t1 - t0).count() / reps / n);
+}
+
+//*************************************
+// vertex layouts: "--bench-vertex"
+// size, packing time and decoding error of every format for the level-of-detail chain of every sphere kind;
+// position-only texcoords are derived per fragment and have no error to report
+inline void run_vertex_benchmark()
+{
+	for (int kind = 0; kind < NUM_SPHERE_KINDS; kind++) {
+		sphere_lods lods = create_sphere_lods(sphere_kind(kind));
+		const std::vector<vertex>& v = lods.vertices;
+		printf("%s: %zu vertices\n", sphere_kind_names[kind], v.size());
+		for (int f = 0; f < NUM_VERTEX_FORMATS; f++) {
+			const int reps = 10;
+			std::vector<unsigned char> packed;
+			auto t0 = std::chrono::high_resolution_clock::now();
+			for (int k = 0; k < reps; k++) packed = pack_vertices(vertex_format(f), v);
+			auto t1 = std::chrono::high_resolution_clock::now();
+
+			double pos_error = 0, normal_degrees = 0, tc_error = 0;
+			for (size_t k = 0; k < v.size(); k++) {
+				vertex d = unpack_vertex(vertex_format(f), packed.data(), k);
+				pos_error = std::max(pos_error, double((d.pos - v[k].pos).length()));
+				vec3 n = d.norm.normalize();
+				normal_degrees = std::max(normal_degrees, atan2(double(n.cross(v[k].norm).length()), double(n.dot(v[k].norm))) * 180 / PI);
+				if (f != VERTEX_POSITION) tc_error = std::max(tc_error, double(std::max(fabs(d.tex.x - v[k].tex.x), fabs(d.tex.y - v[k].tex.y))));
+			}
+			printf("  %-14s %2u B/vertex %8.2f MB (%.2fx), pack %6.2f ms, error: position %.1e, normal %.3f deg, texcoord %.1e\n",
+				vertex_format_names[f], vertex_stride(vertex_format(f)), packed.size() / 1048576.0, double(sizeof(vertex)) / vertex_stride(vertex_format(f)),
+				std::chrono::duration<double, std::milli>(t1 - t0).count() / reps, pos_error, normal_degrees, tc_error);
+		}
+	}
+}
+
+//*************************************
+// asteroid field of n bodies around a sun: a thin disk on circular orbits with small random masses
+inline nbody_system create_asteroid_field( uint n, uint seed=1234 )
+{
+	nbody_system system;
+	pcg32 rng(seed);
+	float sun_mass = 14.4f * 14.4f * 14.4f;	// same sun as create_planet_system()
+	system.bodies.reserve(n);
+	system.bodies.push_back(vec3(0.0f), vec3(0.0f), sun_mass);
+	for (uint k = 1; k < n; k++) {
+		float r = rng.uniform(10.0f, 60.0f), phi = rng.uniform(0.0f, 2 * PI);
+		vec3 p = vec3(r * cos(phi), r * sin(phi), rng.uniform(-0.5f, 0.5f));
+		vec3 v = vec3(-sin(phi), cos(phi), 0.0f) * sqrt(system.G * sun_mass / r);
+		system.bodies.push_back(p, v, rng.uniform(0.5f, 1.5f) * sun_mass * 1e-7f);
+	}
+	system.eps = 0.05f;
+	return system;
+}
+
+//*************************************
+// gravity: "--bench-nbody [bodies]"
+// the O(N^2) reference is timed on a sample of bodies, which also measures the force error of the tree
+inline void run_nbody_benchmark( uint n )
+{
+	nbody_system system = create_asteroid_field(n);
+	printf("%u bodies, %u threads, theta %.2f\n", n, system.threads, system.theta);
+
+	// direct sum on up to 1024 sampled bodies
+	std::vector<int> sample;
+	for (uint k = 0; k < n; k += std::max(1u, n / 1024)) sample.push_back(int(k));
+	std::vector<vec3> reference;
+	auto t0 = std::chrono::high_resolution_clock::now();
+	system.compute_forces_direct(sample, reference);
+	auto t1 = std::chrono::high_resolution_clock::now();
+	double direct_s = std::chrono::duration<double>(t1 - t0).count();
+	double direct_rate = double(sample.size()) * n / direct_s;
+
+	// tree forces of all bodies
+	t0 = std::chrono::high_resolution_clock::now();
+	system.compute_forces();
+	t1 = std::chrono::high_resolution_clock::now();
+	double tree_s = std::chrono::duration<double>(t1 - t0).count();
+	double err = 0;
+	for (size_t s = 0; s < sample.size(); s++) {
+		int i = sample[s];
+		vec3 d = vec3(system.bodies.ax[i], system.bodies.ay[i], system.bodies.az[i]) - reference[s];
+		err += length(d) / length(reference[s]);
+	}
+
+	printf("%12s %14s %16s %14s\n", "path", "ms/step", "interactions", "Minteract/s");
+	printf("%12s %14.1f %16.0f %14.1f\n", "direct", 1000.0 * double(n) * n / direct_rate, double(n) * n, direct_rate / 1e6);
+	printf("%12s %14.1f %16zu %14.1f\n", "barnes-hut", 1000.0 * tree_s, system.interactions, system.interactions / tree_s / 1e6);
+	printf("speedup %.1fx over direct, mean relative force error %.2e\n", double(n) * n / direct_rate / tree_s, err / sample.size());
+}
+
+// long-run energy drift of the leapfrog integrator with the tree forces
+inline void run_energy_benchmark( uint n, int steps )
+{
+	auto planets = create_planets();
+	auto scene = create_scene(planets);
+	scene.update();
+	nbody_system system = n <= 8 ? create_planet_system(planets, scene) : create_asteroid_field(n);
+	double e0 = system.energy(), worst = 0;
+	auto t0 = std::chrono::high_resolution_clock::now();
+	for (int k = 1; k <= steps; k++) {
+		system.step();
+		if (k % std::max(1, steps / 10) == 0) {
+			double e = system.energy();
+			worst = std::max(worst, fabs((e - e0) / e0));
+			printf("%10d steps: relative energy error %.3e\n", k, (e - e0) / e0);
+		}
+	}
+	auto t1 = std::chrono::high_resolution_clock::now();
+	printf("%zu bodies, %d steps of %.5f s in %.1f s, worst relative energy error %.3e\n", system.bodies.size(), steps, system.dt, std::chrono::duration<double>(t1 - t0).count(), worst);
+}
+
+#endif // __BENCH_H__
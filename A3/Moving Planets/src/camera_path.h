@@ -0,0 +1,166 @@
+#pragma once
+#ifndef __CAMERA_PATH_H__
+#define __CAMERA_PATH_H__
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "cgmath.h"		// no GL or GLFW dependency below this point
+
+//*************************************
+// scripted camera for load tests: a path replaces the mouse handlers and sets cam.view_matrix every frame
+// one command per line, '#' starts a comment; every timed command starts from where the previous one ended
+//   eye x y z | at x y z | up x y z		place the camera at once
+//   move S x y z [ax ay az]				eye (and target) to the given points in S seconds
+//   orbit S turns [ax ay az]				eye and up about the target, around up or the given axis
+//   zoom S distance						eye along the view direction to the distance from the target
+//   wait S									hold still
+// points are in units of the default solar system and are multiplied by the scale of the scene;
+// zoom distances are not, so that approaching a body looks the same in every scene
+enum path_op { PATH_EYE=0, PATH_AT, PATH_UP, PATH_MOVE, PATH_ORBIT, PATH_ZOOM, PATH_WAIT };
+
+struct camera_pose
+{
+	vec3	eye = vec3(0,70,0);		// same as the default camera of main.cpp
+	vec3	at = vec3(0,0,0);
+	vec3	up = vec3(0,0,1);
+	mat4	view_matrix() const { return mat4::look_at( eye, at, up ); }
+};
+
+struct path_segment
+{
+	path_op	op;
+	float	seconds = 0.0f;
+	vec3	a, b;				// point or axis, and the target of move
+	float	value = 0.0f;		// turns of orbit, distance of zoom
+	bool	b_second = false;	// b given?
+};
+
+// v rotated by angle about the unit axis (Rodrigues)
+inline vec3 rotate_about( vec3 v, vec3 axis, float angle )
+{
+	float c = cos(angle), s = sin(angle);
+	return v*c + axis.cross(v)*s + axis*(axis.dot(v)*(1-c));
+}
+
+// smooth start and stop of move and zoom; orbits turn at a constant rate
+inline float path_ease( float x ){ return x*x*(3-2*x); }
+
+struct camera_path
+{
+	std::string					name;		// file name without the directory and extension
+	std::vector<path_segment>	segments;
+	float						duration = 0.0f;
+
+	bool		empty() const { return segments.empty(); }
+	bool		load( const char* path );
+	camera_pose	evaluate( float t, float scale ) const;
+	void		apply( const path_segment& s, float x, float scale, camera_pose& p ) const;
+};
+
+//*************************************
+inline bool camera_path::load( const char* path )
+{
+	FILE* fp = fopen( path, "r" ); if(!fp){ printf( "%s(): unable to open %s\n", __func__, path ); return false; }
+	const char* base = std::max( strrchr(path,'/'), strrchr(path,'\\') );
+	name = base ? base+1 : path; name = name.substr( 0, name.rfind('.') );
+	segments.clear(); duration = 0.0f;
+
+	static const char* ops[] = { "eye", "at", "up", "move", "orbit", "zoom", "wait" };
+	char line[256]; int n = 0;
+	while( fgets(line,sizeof(line),fp) )
+	{
+		n++; if(char* c=strchr(line,'#')) *c = 0;
+		char cmd[16]; float v[7]; int k = 0;
+		if(sscanf(line," %15s%n",cmd,&k)<1) continue;	// blank or comment
+		int count = sscanf( line+k, "%f %f %f %f %f %f %f", v, v+1, v+2, v+3, v+4, v+5, v+6 );
+
+		path_segment s; int op = 0;
+		for( ; op < int(sizeof(ops)/sizeof(ops[0])) && strcmp(cmd,ops[op]); op++ );
+		s.op = path_op(op);
+		bool b_valid = true;
+		if(op<=PATH_UP){ b_valid = count==3; s.a = vec3(v[0],v[1],v[2]); }
+		else if(op==PATH_MOVE){ b_valid = count==4||count==7; s.seconds = v[0]; s.a = vec3(v[1],v[2],v[3]); s.b_second = count==7; if(s.b_second) s.b = vec3(v[4],v[5],v[6]); }
+		else if(op==PATH_ORBIT){ b_valid = count==2||count==5; s.seconds = v[0]; s.value = v[1]; s.b_second = count==5; if(s.b_second){ s.a = vec3(v[2],v[3],v[4]); b_valid = b_valid&&s.a.length()>0; } }
+		else if(op==PATH_ZOOM){ b_valid = count==2&&v[1]>0; s.seconds = v[0]; s.value = v[1]; }
+		else if(op==PATH_WAIT){ b_valid = count==1; s.seconds = v[0]; }
+		else b_valid = false;
+		if(!b_valid||s.seconds<0){ printf( "%s(): %s:%d: invalid command: %s", __func__, path, n, line ); fclose(fp); return false; }
+		segments.push_back( s ); duration += s.seconds;
+	}
+	fclose( fp );
+	if(duration<=0){ printf( "%s(): %s has no timed commands\n", __func__, path ); return false; }
+	return true;
+}
+
+// pose at time t in [0,duration]; the poses between segments are recomputed from the start, which is cheap for a few dozen commands
+inline camera_pose camera_path::evaluate( float t, float scale ) const
+{
+	camera_pose p; p.eye *= scale;
+	for( auto& s : segments )
+	{
+		if(s.seconds>0&&t<s.seconds){ apply( s, t/s.seconds, scale, p ); break; }
+		apply( s, 1.0f, scale, p ); t -= s.seconds;
+	}
+	return p;
+}
+
+// pose of the fraction x of a segment started at p
+inline void camera_path::apply( const path_segment& s, float x, float scale, camera_pose& p ) const
+{
+	if(s.op==PATH_EYE) p.eye = s.a*scale;
+	else if(s.op==PATH_AT) p.at = s.a*scale;
+	else if(s.op==PATH_UP) p.up = s.a.normalize();
+	else if(s.op==PATH_MOVE)
+	{
+		float e = path_ease(x);
+		p.eye = p.eye*(1-e) + s.a*scale*e;
+		if(s.b_second) p.at = p.at*(1-e) + s.b*scale*e;
+	}
+	else if(s.op==PATH_ORBIT)
+	{
+		vec3 axis = s.b_second ? s.a.normalize() : p.up;
+		float angle = s.value*2*PI*x;
+		p.eye = p.at + rotate_about( p.eye-p.at, axis, angle );
+		p.up = rotate_about( p.up, axis, angle );
+	}
+	else if(s.op==PATH_ZOOM)
+	{
+		vec3 d = p.eye-p.at; float r0 = d.length();	// geometric steps, so the approach looks steady at any distance
+		if(r0>0) p.eye = p.at + d*(pow(s.value/r0,path_ease(x)));
+	}
+}
+
+//*************************************
+// frame times, draw calls, triangles and visible bodies of one run of a path
+struct path_run
+{
+	std::string			path, mode;
+	uint				bodies = 0;
+	std::vector<float>	frame_ms;	// until glFinish() returns
+	double				draws = 0, triangles = 0, visible = 0;	// sums over the frames
+
+	void clear(){ frame_ms.clear(); draws = triangles = visible = 0; }
+	void add( float ms, int d, double tris, int v ){ frame_ms.push_back( ms ); draws += d; triangles += tris; visible += v; }
+};
+
+// one CSV row per run; columns are stable, so the files of two builds diff line by line
+inline void write_path_header( FILE* fp, const char* renderer, ivec2 size, double fps )
+{
+	fprintf( fp, "# Moving Planets camera-path benchmark; %s, %dx%d, %g frames per second\n", renderer, size.x, size.y, fps );
+	fprintf( fp, "path,bodies,mode,frames,mean_ms,p50_ms,p90_ms,p95_ms,p99_ms,max_ms,draws_per_frame,triangles_per_frame,visible_per_frame\n" );
+}
+
+inline void write_path_run( FILE* fp, const path_run& r )
+{
+	if(r.frame_ms.empty()) return;
+	std::vector<float> v = r.frame_ms; std::sort( v.begin(), v.end() );
+	auto p = [&]( float q ){ return v[std::min(v.size()-1,size_t(ceil(q*v.size()))-1)]; };	// nearest rank
+	double mean = 0; for( float ms : v ) mean += ms; mean /= v.size();
+	double n = double(v.size());
+	fprintf( fp, "%s,%u,%s,%zu,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.1f,%.0f,%.1f\n", r.path.c_str(), r.bodies, r.mode.c_str(), v.size(),
+		mean, p(0.50f), p(0.90f), p(0.95f), p(0.99f), v.back(), r.draws/n, r.triangles/n, r.visible/n );
+}
+
+#endif // __CAMERA_PATH_H__
@@ -0,0 +1,85 @@
+#pragma once
+#ifndef __FRUSTUM_H__
+#define __FRUSTUM_H__
+#include <vector>
+#include "cgmath.h"		// no GL or GLFW dependency below this point
+
+// AVX when the compiler targets it (e.g., -mavx2 or /arch:AVX2), SSE2 on any x64, otherwise scalar only
+#if defined(__AVX__)
+	#include <immintrin.h>
+#elif defined(__SSE2__)||defined(_M_X64)||(defined(_M_IX86_FP)&&_M_IX86_FP>=2)
+	#include <emmintrin.h>
+	#define CG_SSE2
+#endif
+
+//*************************************
+// six normalized planes (nx,ny,nz,d) of a view frustum; a point p is inside when dot(n,p)+d >= 0 for every plane
+struct frustum
+{
+	vec4	planes[6];	// left, right, bottom, top, near, far
+};
+
+// planes of the clip volume of a row-major view-projection matrix (Gribb-Hartmann)
+inline frustum make_frustum( const mat4& m )
+{
+	vec4 r1(m._11,m._12,m._13,m._14), r2(m._21,m._22,m._23,m._24), r3(m._31,m._32,m._33,m._34), r4(m._41,m._42,m._43,m._44);
+	vec4 p[6] = { r4+r1, r4+r1*-1.0f, r4+r2, r4+r2*-1.0f, r4+r3, r4+r3*-1.0f };
+	frustum f;
+	for( int k=0; k < 6; k++ )
+	{
+		float l = sqrt(p[k].x*p[k].x+p[k].y*p[k].y+p[k].z*p[k].z);
+		f.planes[k] = p[k]*(1.0f/l);
+	}
+	return f;
+}
+
+//*************************************
+// indices of the spheres (x,y,z,r) that intersect the frustum, appended to visible in increasing order
+// z may be null for spheres on the z=0 plane; returns the number of visible spheres
+inline size_t cull_spheres( const frustum& f, const float* x, const float* y, const float* z, const float* r, size_t n, std::vector<uint>& visible )
+{
+	visible.clear();
+	size_t k = 0;
+#if defined(__AVX__)
+	__m256 nx[6], ny[6], nz[6], nd[6];
+	for( int p=0; p < 6; p++ ){ nx[p] = _mm256_set1_ps(f.planes[p].x); ny[p] = _mm256_set1_ps(f.planes[p].y); nz[p] = _mm256_set1_ps(f.planes[p].z); nd[p] = _mm256_set1_ps(f.planes[p].w); }
+	for( ; k+8 <= n; k+=8 )
+	{
+		__m256 vx = _mm256_loadu_ps(x+k), vy = _mm256_loadu_ps(y+k), vz = z ? _mm256_loadu_ps(z+k) : _mm256_setzero_ps();
+		__m256 nr = _mm256_sub_ps(_mm256_setzero_ps(),_mm256_loadu_ps(r+k));
+		__m256 in = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for( int p=0; p < 6; p++ )
+		{
+			__m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx[p],vx),_mm256_mul_ps(ny[p],vy)),_mm256_add_ps(_mm256_mul_ps(nz[p],vz),nd[p]));
+			in = _mm256_and_ps(in,_mm256_cmp_ps(d,nr,_CMP_GE_OQ));
+		}
+		int bits = _mm256_movemask_ps(in);
+		for( int b=0; b < 8; b++ ) if(bits&(1<<b)) visible.push_back( uint(k+b) );
+	}
+#elif defined(CG_SSE2)
+	__m128 nx[6], ny[6], nz[6], nd[6];
+	for( int p=0; p < 6; p++ ){ nx[p] = _mm_set1_ps(f.planes[p].x); ny[p] = _mm_set1_ps(f.planes[p].y); nz[p] = _mm_set1_ps(f.planes[p].z); nd[p] = _mm_set1_ps(f.planes[p].w); }
+	for( ; k+4 <= n; k+=4 )
+	{
+		__m128 vx = _mm_loadu_ps(x+k), vy = _mm_loadu_ps(y+k), vz = z ? _mm_loadu_ps(z+k) : _mm_setzero_ps();
+		__m128 nr = _mm_sub_ps(_mm_setzero_ps(),_mm_loadu_ps(r+k));
+		__m128 in = _mm_cmpeq_ps(vx,vx);	// all ones except for NaN
+		for( int p=0; p < 6; p++ )
+		{
+			__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[p],vx),_mm_mul_ps(ny[p],vy)),_mm_add_ps(_mm_mul_ps(nz[p],vz),nd[p]));
+			in = _mm_and_ps(in,_mm_cmpge_ps(d,nr));
+		}
+		int bits = _mm_movemask_ps(in);
+		for( int b=0; b < 4; b++ ) if(bits&(1<<b)) visible.push_back( uint(k+b) );
+	}
+#endif
+	for( ; k < n; k++ )
+	{
+		bool b_in = true;
+		for( int p=0; p < 6 && b_in; p++ ) b_in = f.planes[p].x*x[k]+f.planes[p].y*y[k]+(z?f.planes[p].z*z[k]:0.0f)+f.planes[p].w >= -r[k];
+		if(b_in) visible.push_back( uint(k) );
+	}
+	return visible.size();
+}
+
+#endif // __FRUSTUM_H__
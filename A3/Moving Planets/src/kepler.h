@@ -0,0 +1,99 @@
+#pragma once
+#ifndef __KEPLER_H__
+#define __KEPLER_H__
+#include <vector>
+#include "cgmath.h"		// no GL or GLFW dependency below this point
+
+//*************************************
+// simulation time as a closed-form function of the wall clock; no per-frame accumulation
+// time warp and seek rebase the clock, so any time costs the same and nothing drifts
+struct sim_clock
+{
+	double	base = 0.0;			// simulation time at wall_base
+	double	wall_base = 0.0;	// wall-clock time of the last rebase
+	double	scale = 1.0;		// simulation seconds per wall-clock second
+
+	double	time( double wall ) const { return base+(wall-wall_base)*scale; }
+	void	seek( double wall, double t ){ base = t; wall_base = wall; }
+	void	warp( double wall, double s ){ base = time(wall); wall_base = wall; scale = s; }
+};
+
+// angle in [0,2pi) without losing the fraction of a large argument to float
+inline float wrap_angle( double theta ){ double t = fmod( theta, 2*PI ); return float(t<0 ? t+2*PI : t); }
+
+//*************************************
+// planar elliptical orbits evaluated in closed form at any double-precision time
+// structure of arrays, so that every stage of evaluate() is a branch-free loop over all bodies
+struct kepler_orbits
+{
+	std::vector<double>	a;				// semi-major axis
+	std::vector<double>	e;				// eccentricity in [0,0.9]
+	std::vector<double>	periapsis;		// direction of the periapsis in the plane
+	std::vector<double>	mean_anomaly;	// mean anomaly at time 0
+	std::vector<double>	mean_motion;	// radians per second
+	std::vector<double>	height;			// constant offset along z
+	std::vector<double>	b, pc, ps;		// constant per orbit: semi-minor axis, cos and sin of the periapsis
+	std::vector<double>	M, E, sE, cE;	// scratch: mean and eccentric anomalies of the last evaluate()
+	std::vector<vec3>	position;		// positions of the last evaluate(), relative to the focus
+
+	size_t	size() const { return a.size(); }
+	void	push_back( double a, double e, double periapsis, double mean_anomaly, double mean_motion, double height=0 );
+	void	evaluate( double t );
+};
+
+inline void kepler_orbits::push_back( double _a, double _e, double _periapsis, double _mean_anomaly, double _mean_motion, double _height )
+{
+	a.push_back(_a); e.push_back(_e); periapsis.push_back(_periapsis);
+	mean_anomaly.push_back(_mean_anomaly); mean_motion.push_back(_mean_motion); height.push_back(_height);
+	b.push_back(_a*sqrt(1-_e*_e)); pc.push_back(cos(_periapsis)); ps.push_back(sin(_periapsis));
+}
+
+//*************************************
+// solve E - e sin(E) = M for n bodies with a fixed number of Newton iterations; also returns sin(E) and cos(E)
+// no per-body branches or early exits, and the iterations carry sin(E) and cos(E) along by rotating them with
+// a polynomial sin/cos of the small correction, so the inner loop is plain arithmetic that vectorizes across bodies;
+// a final exact sin/cos and Newton step remove the error of the polynomials for e <= 0.9
+inline void solve_kepler( const double* M, const double* e, double* E, double* sE, double* cE, size_t n )
+{
+	for( size_t k=0; k < n; k++ )
+	{
+		E[k] = M[k]+e[k]*sin(M[k])*(1+e[k]*cos(M[k]));
+		sE[k] = sin(E[k]); cE[k] = cos(E[k]);
+	}
+	for( size_t k=0; k < n; k++ )
+	{
+		double x = E[k], s = sE[k], c = cE[k];
+		for( int iter=0; iter < 4; iter++ )
+		{
+			double d = -(x-e[k]*s-M[k])/(1-e[k]*c), d2 = d*d;
+			double sd = d*(1-d2*(1/6.0-d2*(1/120.0-d2/5040))), cd = 1-d2*(0.5-d2*(1/24.0-d2/720));
+			double t = s*cd+c*sd; c = c*cd-s*sd; s = t; x += d;
+		}
+		E[k] = x;
+	}
+	for( size_t k=0; k < n; k++ )
+	{
+		sE[k] = sin(E[k]); cE[k] = cos(E[k]);
+		double d = -(E[k]-e[k]*sE[k]-M[k])/(1-e[k]*cE[k]);
+		E[k] += d; sE[k] += cE[k]*d; cE[k] -= sE[k]*d;
+	}
+}
+
+inline void kepler_orbits::evaluate( double t )
+{
+	size_t n = size();
+	M.resize(n); E.resize(n); sE.resize(n); cE.resize(n); position.resize(n);
+
+	// mean anomalies reduced to [-pi,pi], where the starter is accurate
+	for( size_t k=0; k < n; k++ ){ double m = fmod( mean_anomaly[k]+mean_motion[k]*t, 2*PI ); M[k] = m>PI ? m-2*PI : m<-PI ? m+2*PI : m; }
+	solve_kepler( M.data(), e.data(), E.data(), sE.data(), cE.data(), n );
+
+	// position on the ellipse with the focus at the origin, rotated to the periapsis
+	for( size_t k=0; k < n; k++ )
+	{
+		double px = a[k]*(cE[k]-e[k]), py = b[k]*sE[k];
+		position[k] = vec3( float(pc[k]*px-ps[k]*py), float(ps[k]*px+pc[k]*py), float(height[k]) );
+	}
+}
+
+#endif // __KEPLER_H__
@@ -2,13 +2,29 @@
 #include "cgut.h"		// slee's OpenGL utility
 #include "trackball.h"	// virtual trackball
 #include "planet.h"		// planets header
+#include "uniforms.h"	// cached uniform locations and values
+#include "uniform_buffer.h"	// per-frame camera block shared by programs
+#include "frustum.h"	// view-frustum culling
+#include "sphere_lod.h"	// sphere levels of detail
+#include "vertex_format.h"	// compact vertex layouts
+#include "bench.h"		// headless benchmark
+#include "headless.h"	// offscreen rendering without a window
+#include "gpu_timer.h"	// CPU and GPU frame profiler
+#include "replay.h"		// input recording and replay
+#include "camera_path.h"	// scripted camera paths
+#include "soft_raster.h"	// tile-based software rasterizer
 
 //*************************************
 // global constants
 static const char*	window_name = "Moving Planets";
 static const char*	vert_shader_path = "../bin/shaders/transform.vert";
 static const char*	frag_shader_path = "../bin/shaders/transform.frag";
+static const char*	impostor_vert_shader_path = "../bin/shaders/impostor.vert";
+static const char*	impostor_frag_shader_path = "../bin/shaders/impostor.frag";
 static const bool	b_index_buffer = true; // always use index buffer
+static const char*	bench_path_files[] = { "../bin/paths/orbit.path", "../bin/paths/sun.path", "../bin/paths/flythrough.path", "../bin/paths/spin.path" };
+static const uint	bench_mesh_limit = 10000;	// larger scenes are only drawn as impostors by "--bench-paths"
+static const int	bench_warmup_frames = 10;	// rendered before each run and not measured
 
 //*************************************
 // common structures
@@ -32,35 +48,83 @@ struct camera
 // window objects
 GLFWwindow*	window = nullptr;
 ivec2		window_size = ivec2(1280, 720); // initial window size
+headless_t	headless;	// offscreen rendering for a fixed number of frames or seconds
+soft_rasterizer	raster;	// "--software" renders headless on the CPU instead of OpenGL
 
 //*************************************
 // OpenGL objects
 GLuint	program	= 0;	// ID holder for GPU program
 GLuint	vertex_array = 0;	// ID holder for vertex array object
+GLuint	empty_array = 0;	// vertex array without attributes for the procedural spheres
+GLuint	impostor_program = 0;	// ray-cast spheres on screen-aligned quads
+GLuint	impostor_array = 0;		// per-instance attributes of the impostors
+GLuint	impostor_buffer = 0;	// ID holder for the impostor instances
+program_uniforms	uniforms;	// active uniforms of the program
+uniform_buffer<camera_block>	camera_buffer;	// view and projection, written once per frame
+
+// typed handles of the uniforms, resolved once after linking
+struct
+{
+	uniform<mat4>	model_matrix;
+	uniform<uint>	vertex_format, sphere_slices, sphere_stacks;
+	uniform<int>	b_procedural;
+} u;
 
 //*************************************
 // global variables
 int		frame = 0;		// index of rendering frames
 uint	tc_mode = 0;	// To toggle colors
 auto	planets = std::move(create_planets());
-float	rotation_time_elapsed = 0.0f;	// only count the time of rotating
-float	time_checkpoint = 0.0f;	// starting point of elapsed time
+auto	scene = create_scene(planets);	// cached transform hierarchy of the planets
+auto	orbits = create_orbits(planets);	// closed-form orbits of all bodies
+sim_clock	world_clock;				// simulation time from the wall clock, with time warp and seek
+double	sim_time = 0.0;					// simulation time of the current frame
 bool	right_button_clicked = false;	// right mouse clicked?
 bool	shift_button_clicked = false;	// shift button + left mouse clicked?
 bool	control_button_clicked = false; // control button + left mouse clicked?
 bool	middle_button_clicked = false;  // middle mouse clicked?
+bool	b_stats = false;				// print GL calls per frame every second?
+bool	b_gravity = false;				// move the sun and planets by the N-body simulation?
+bool	b_culling = true;				// skip the bodies outside the view frustum?
+bool	b_lod = true;					// choose the sphere resolution by the screen size of each body?
+vertex_format	vformat = VERTEX_FLOAT;	// layout of the vertex buffer
+bool	b_procedural = false;			// generate UV spheres from gl_VertexID without vertex and index buffers?
+bool	b_impostor = false;				// draw every body as a ray-cast quad instead of a mesh?
+nbody_system	gravity;				// sun and planets under gravity; moons stay on their scripted orbits
 double	previous_y = 0.0;				// x-coordinate of the last mouse location
 double	previous_x = 0.0;				// y-coordinate of the last mouse location
 #ifndef GL_ES_VERSION_2_0
 bool	b_wireframe = false;
 #endif
 
-// holder of vertices and indices of a unit sphere, scene objects
-std::vector<vertex>	unit_sphere_vertices;
-std::vector<uint> indices;
+// holder of vertices and indices of the unit sphere levels, scene objects
+sphere_lods	lods;
+std::vector<uint>	lod_levels;		// current level of each body
 camera		cam;
 trackball	tb;
 
+// bounding spheres of the bodies and the indices of the visible ones
+struct { std::vector<float> x, y, z, r; } bounds;
+std::vector<uint>	visible;
+
+// sphere of an impostor; the spin about z orients the texcoords as on the mesh
+struct sphere_instance
+{
+	vec4	sphere;		// world-space center and radius
+	float	spin;		// rotation angle of the model matrix
+};
+std::vector<sphere_instance>	impostors;
+
+// scripted camera of "--path file" and "--bench-paths"; its points are scaled with the size of the scene
+camera_path	path;
+float		path_scale = 1.0f;
+
+// accumulated GL calls and culling counters for the stats output
+struct { int frames=0, gl_calls=0, skipped=0, visible=0, culled=0; double triangles=0, t0=0; } perf;
+
+// draw calls, visible bodies and triangles of the last frame for the path benchmark
+struct { int draws=0, visible=0; double triangles=0; } drawn;
+
 
 //*************************************
 void update()
@@ -68,55 +132,162 @@ void update()
 	cam.aspect = window_size.x / float(window_size.y);
 	cam.projection_matrix = mat4::perspective(cam.fovy, cam.aspect, cam.dnear, cam.dfar);
 
-	// Make the program time-dependent not frame-dependent
-	rotation_time_elapsed += float(glfwGetTime()) - time_checkpoint;
-	time_checkpoint = float(glfwGetTime());
+	// Make the program time-dependent not frame-dependent; the time is evaluated, not accumulated
+	// fixed steps of a virtual clock when recording, replaying, or following a path
+	double wall = path.empty() ? replay().clock(app_time()) : frame * replay().dt;
+	double t = world_clock.time(wall);
+	if (!path.empty()) cam.view_matrix = path.evaluate(float(frame * replay().dt), path_scale).view_matrix();
+	if (b_gravity) { profile_zone zone("simulation"); gravity.advance(float(t - sim_time)); }
+	sim_time = t;
 }
 
-void render()
+// all visible bodies as one instanced draw of four-vertex quads; returns the triangles drawn
+uint draw_impostors()
 {
-	// clear screen (with background color) and clear depth buffer
-	glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
-	
-	// notify GL that we use our own program
-	glUseProgram( program );
-	
-	// bind vertex array object
-	glBindVertexArray(vertex_array);
-
-	// Draw planets one by one
-	for (int i = 0; i < NUM_OF_PLANETS; i++) {
+	impostors.resize(visible.size());
+	for (size_t k = 0; k < visible.size(); k++) {
+		uint i = visible[k];
+		const mat4& m = scene.nodes[i].model_matrix;	// rotation about z times the radius, as built by the scene graph
+		impostors[k] = { vec4(bounds.x[i], bounds.y[i], bounds.z[i], bounds.r[i]), atan2(m._21, m._11) };
+	}
 
-		// rotation update
-		planets.at(i).rotation_theta = planets.at(i).rotation_speed * rotation_time_elapsed;
+	glUseProgram(impostor_program);
+	glBindVertexArray(impostor_array);
+	glBindBuffer(GL_ARRAY_BUFFER, impostor_buffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(sphere_instance) * impostors.size(), nullptr, GL_STREAM_DRAW);	// orphan the storage of the last frame
+	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(sphere_instance) * impostors.size(), impostors.data());
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, GLsizei(impostors.size()));
+	gl_count(6);
+	return uint(impostors.size()) * 2;
+}
 
-		// revolution update
-		planets.at(i).revolution_theta = planets.at(i).revolution_speed * rotation_time_elapsed;
+void render()
+{
+	// clear screen (with background color) and clear depth buffer; the software rasterizer clears each tile before drawing it
+	if (raster.b_enabled) raster.begin_frame();
+	else glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+	
+	// view and projection do not change between planets; every program reads them from the camera block
+	mat4 view_projection_matrix = cam.projection_matrix * cam.view_matrix;
+	if (!raster.b_enabled) { profile_zone zone("uniforms"); camera_buffer.update({ cam.view_matrix, cam.projection_matrix, view_projection_matrix }); }
 
-		// per-planet update
-		planets.at(i).update();
+	// rotation and orbit update at the current time; only the changed nodes and their descendants are recomputed
+	{
+		profile_zone zone("matrices");
+		orbits.evaluate(sim_time);
+		for (int i = 0; i < int(planets.size()); i++) {
+			scene.set_rotation(i, wrap_angle(planets[i].rotation_speed * sim_time));
+			scene.set_offset(i, orbits.position[i]);
+		}
 
-		// update uniform variables in vertex/fragment shaders
-		GLint uloc;
-		uloc = glGetUniformLocation(program, "view_matrix");			if (uloc > -1) glUniformMatrix4fv(uloc, 1, GL_TRUE, cam.view_matrix);
-		uloc = glGetUniformLocation(program, "projection_matrix");	if (uloc > -1) glUniformMatrix4fv(uloc, 1, GL_TRUE, cam.projection_matrix);
-		uloc = glGetUniformLocation(program, "model_matrix");			if (uloc > -1) glUniformMatrix4fv(uloc, 1, GL_TRUE, planets.at(i).model_matrix);
+		// simulated bodies are placed by their offsets from the sun instead of their orbits
+		for (int i = 0; b_gravity && i < int(gravity.bodies.size()); i++) {
+			vec3 p = gravity.bodies.position(i);
+			scene.set_offset(i, i ? p - gravity.bodies.position(0) : p);
+		}
+		scene.update();
+	}
 
-		// render vertices: trigger shader programs to process vertex data
-		// configure transformation parameters
-		glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, nullptr);
+	// bounding spheres of the unit sphere scaled by the radius, tested against the frustum
+	size_t n = scene.nodes.size();
+	bounds.x.resize(n); bounds.y.resize(n); bounds.z.resize(n); bounds.r.resize(n);
+	for (size_t i = 0; i < n; i++) {
+		const scene_node& node = scene.nodes[i];
+		bounds.x[i] = node.model_matrix._14; bounds.y[i] = node.model_matrix._24; bounds.z[i] = node.model_matrix._34; bounds.r[i] = node.radius;
+	}
+	{
+		profile_zone zone("culling");
+		if (b_culling) cull_spheres(make_frustum(view_projection_matrix), bounds.x.data(), bounds.y.data(), bounds.z.data(), bounds.r.data(), n, visible);
+		else { visible.resize(n); for (size_t i = 0; i < n; i++) visible[i] = uint(i); }
 	}
 
-	
+	// Draw visible planets one by one, or as impostors with a single instanced call
+	lod_levels.resize(n, lods.original);
+	float pixels = cam.projection_matrix._22 * window_size.y * 0.5f;	// screen pixels per unit at unit depth
+	double triangles = 0;
+	int draws = 0;
+	gl_count();	// clear
+
+	// level of detail from the projected radius; the depth is along the view direction
+	auto select_level = [&](uint i) {
+		const mat4& v = cam.view_matrix;
+		float depth = -(v._31 * bounds.x[i] + v._32 * bounds.y[i] + v._33 * bounds.z[i] + v._34);
+		float screen_radius = depth > bounds.r[i] ? bounds.r[i] * pixels / depth : float(window_size.y);
+		return lod_levels[i] = b_lod ? lods.select(screen_radius, lod_levels[i]) : lods.original;
+	};
+
+	// the software rasterizer draws the meshes of the same levels in every mode, since impostors and procedural spheres are shaders
+	if (raster.b_enabled) {
+		{
+			profile_zone zone("draw");
+			for (uint i : visible) {
+				const sphere_lods::level& level = lods.levels[select_level(i)];
+				raster.draw(view_projection_matrix * scene.nodes[i].model_matrix, lods.vertices.data(), lods.indices.data() + level.first_index, level.index_count);
+				triangles += level.index_count / 3;
+			}
+			draws = int(visible.size());
+		}
+		profile_zone zone("raster");
+		raster.end_frame();
+	}
+	else {
+		gpu_zone zone("draw");
+		if (b_impostor) { triangles = draw_impostors(); draws = 1; }
+		else {
+			// notify GL that we use our own program
+			glUseProgram( program );
+		
+			// bind vertex array object; the procedural spheres read no attributes
+			glBindVertexArray(b_procedural ? empty_array : vertex_array);
+			gl_count(2);
+			uniforms.set(u.vertex_format, uint(vformat));
+			uniforms.set(u.b_procedural, int(b_procedural));
+
+			for (uint i : visible) {
+				uint l = select_level(i);
+
+				// update uniform variables in vertex/fragment shaders
+				uniforms.set(u.model_matrix, scene.nodes[i].model_matrix);
+
+				// render vertices: trigger shader programs to process vertex data
+				// configure transformation parameters
+				if (b_procedural) {
+					// the level is only a pair of uniforms, so a change of resolution uploads nothing else
+					uniforms.set(u.sphere_slices, lods.levels[l].slices);
+					uniforms.set(u.sphere_stacks, lods.levels[l].stacks);
+					glDrawArrays(GL_TRIANGLES, 0, lods.levels[l].slices * lods.levels[l].stacks * 6);
+					triangles += lods.levels[l].slices * lods.levels[l].stacks * 2;
+				}
+				else {
+					glDrawElements(GL_TRIANGLES, lods.levels[l].index_count, lods.index_size() == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, lods.offset(l));
+					triangles += lods.triangles(l);
+				}
+				gl_count();
+			}
+			draws = int(visible.size());
+		}
+	}
+	drawn.draws = draws; drawn.visible = int(visible.size()); drawn.triangles = triangles;
+
+	// GL calls of this frame
+	double t = app_time();
+	perf.frames++; perf.gl_calls += gl_calls().total(); perf.skipped += gl_calls().skipped; gl_calls() = {};
+	perf.visible += int(visible.size()); perf.culled += int(n - visible.size()); perf.triangles += triangles;
+	if (t - perf.t0 >= 1.0) {
+		if (b_stats) printf("> %d GL calls/frame (%d uploads skipped), %d visible, %d culled, %.0f triangles\n", perf.gl_calls / perf.frames, perf.skipped / perf.frames, perf.visible / perf.frames, perf.culled / perf.frames, perf.triangles / perf.frames);
+		perf = {}; perf.t0 = t;
+	}
 
-	// swap front and back buffers, and display to screen
-	glfwSwapBuffers( window );
+	// swap front and back buffers, and display to screen; the headless FBO is never presented
+	profile_zone zone("swap");
+	if (!headless.b_enabled) glfwSwapBuffers( window );
 }
 
 void update_vertex_buffer(const std::vector<vertex>& vertices, uint N)
 {
 	static GLuint vertex_buffer = 0;	// ID holder for vertex buffer
 	static GLuint index_buffer = 0;		// ID holder for index buffer
+	if (raster.b_enabled) return;		// the software rasterizer reads lods directly
 
 	// clear and create new buffers
 	if (vertex_buffer)	glDeleteBuffers(1, &vertex_buffer);	vertex_buffer = 0;
@@ -131,17 +302,18 @@ void update_vertex_buffer(const std::vector<vertex>& vertices, uint N)
 		// generation of vertex buffer: use vertices as it is
 		glGenBuffers(1, &vertex_buffer);
 		glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(vertex) * vertices.size(), &vertices[0], GL_STATIC_DRAW);
+		std::vector<unsigned char> packed = pack_vertices(vformat, vertices);
+		glBufferData(GL_ARRAY_BUFFER, packed.size(), packed.data(), GL_STATIC_DRAW);
 
 		// geneation of index buffer
 		glGenBuffers(1, &index_buffer);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint) * indices.size(), &indices[0], GL_STATIC_DRAW);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, lods.index_bytes(), lods.index_data(), GL_STATIC_DRAW);
 	}
 
 	// generate vertex array object, which is mandatory for OpenGL 3.3 and higher
 	if (vertex_array) glDeleteVertexArrays(1, &vertex_array);
-	vertex_array = cg_create_vertex_array(vertex_buffer, index_buffer);
+	vertex_array = create_vertex_array(vformat, vertex_buffer, index_buffer);
 	if (!vertex_array) { printf("%s(): failed to create vertex aray\n", __func__); return; }
 }
 
@@ -162,6 +334,17 @@ void print_help()
 	printf("- press 'w' to toggle wireframe\n");
 	printf("- press Home to reset camera\n");
 #endif
+	printf("- press 'g' to toggle N-body gravity of the sun and planets\n");
+	printf("- press '[' or ']' to slow down or speed up time, Backspace to reset it\n");
+	printf("- press PageUp or PageDown to seek 1000 seconds forward or backward\n");
+	printf("- press 'f' to toggle view-frustum culling\n");
+	printf("- press 'l' to toggle screen-space level of detail of the spheres\n");
+	printf("- press 'm' to cycle uv sphere > icosphere > cube sphere\n");
+	printf("- press 'v' to cycle float > octahedral > 10:10:10:2 > position-only vertices\n");
+	printf("- press 'b' to toggle buffer-free procedural UV spheres\n");
+	printf("- press 'o' to toggle ray-cast sphere impostors\n");
+	printf("- press 'p' to toggle printing GL calls and culled bodies per frame\n");
+	printf("- press 'u' to toggle between cached and per-draw uniform lookups\n");
 	printf( "\n" );
 }
 
@@ -169,10 +352,10 @@ void keyboard( GLFWwindow* window, int key, int scancode, int action, int mods )
 {
 	if(action==GLFW_PRESS)
 	{
-		if(key==GLFW_KEY_ESCAPE||key==GLFW_KEY_Q)	glfwSetWindowShouldClose( window, GL_TRUE );
+		if(key==GLFW_KEY_ESCAPE||key==GLFW_KEY_Q){ if(window) glfwSetWindowShouldClose( window, GL_TRUE ); }	// no window in a headless replay
 		else if(key==GLFW_KEY_H||key==GLFW_KEY_F1)	print_help();
 #ifndef GL_ES_VERSION_2_0
-		else if (key == GLFW_KEY_W)
+		else if (key == GLFW_KEY_W && !raster.b_enabled)
 		{
 			b_wireframe = !b_wireframe;
 			glPolygonMode(GL_FRONT_AND_BACK, b_wireframe ? GL_LINE : GL_FILL);
@@ -180,6 +363,68 @@ void keyboard( GLFWwindow* window, int key, int scancode, int action, int mods )
 		}
 #endif
 		else if (key == GLFW_KEY_HOME)	cam = camera();
+		else if (key == GLFW_KEY_LEFT_BRACKET || key == GLFW_KEY_RIGHT_BRACKET || key == GLFW_KEY_BACKSPACE)
+		{
+			double s = key == GLFW_KEY_BACKSPACE ? 1.0 : world_clock.scale * (key == GLFW_KEY_RIGHT_BRACKET ? 2.0 : 0.5);
+			world_clock.warp(replay().clock(app_time()), s);
+			printf("> time warp %gx\n", s);
+		}
+		else if (key == GLFW_KEY_PAGE_UP || key == GLFW_KEY_PAGE_DOWN)
+		{
+			double wall = replay().clock(app_time());
+			world_clock.seek(wall, world_clock.time(wall) + (key == GLFW_KEY_PAGE_UP ? 1000.0 : -1000.0));
+			if (b_gravity) { gravity.accumulator = 0.0f; sim_time = world_clock.time(wall); }	// the simulation cannot seek; it continues from its state
+			printf("> time %.1f s\n", world_clock.time(wall));
+		}
+		else if (key == GLFW_KEY_L)
+		{
+			b_lod = !b_lod;
+			printf("> using %s spheres\n", b_lod ? "level-of-detail" : "72x36");
+		}
+		else if (key == GLFW_KEY_M)
+		{
+			lods = create_sphere_lods(sphere_kind((lods.kind + 1) % NUM_SPHERE_KINDS));
+			update_vertex_buffer(lods.vertices, 0);
+			lods.print_stats();
+		}
+		else if (key == GLFW_KEY_V)
+		{
+			vformat = vertex_format((vformat + 1) % NUM_VERTEX_FORMATS);
+			update_vertex_buffer(lods.vertices, 0);
+			printf("> using %s vertices: %u bytes each, %.2f MB\n", vertex_format_names[vformat], vertex_stride(vformat), lods.vertices.size() * vertex_stride(vformat) / 1048576.0);
+		}
+		else if (key == GLFW_KEY_B)
+		{
+			b_procedural = !b_procedural;
+			printf("> using %s\n", b_procedural ? "procedural UV spheres from gl_VertexID" : "vertex and index buffers");
+		}
+		else if (key == GLFW_KEY_O)
+		{
+			b_impostor = !b_impostor;
+			printf("> using %s\n", b_impostor ? "ray-cast impostors" : "sphere meshes");
+		}
+		else if (key == GLFW_KEY_F)
+		{
+			b_culling = !b_culling;
+			printf("> %s view-frustum culling\n", b_culling ? "using" : "not using");
+		}
+		else if (key == GLFW_KEY_G)
+		{
+			// start from the current positions, or go back to the scripted orbits
+			b_gravity = !b_gravity;
+			if (b_gravity) gravity = create_planet_system(planets, scene);
+			printf("> using %s orbits\n", b_gravity ? "N-body" : "scripted");
+		}
+		else if (key == GLFW_KEY_P)
+		{
+			b_stats = !b_stats;
+			printf("> %s stats\n", b_stats ? "printing" : "hiding");
+		}
+		else if (key == GLFW_KEY_U)
+		{
+			uniforms.b_bypass = !uniforms.b_bypass;
+			printf("> using %s uniforms\n", uniforms.b_bypass ? "per-draw lookups of" : "cached");
+		}
 	}
 }
 
@@ -187,7 +432,7 @@ void mouse( GLFWwindow* window, int button, int action, int mods )
 {
 	if (button == GLFW_MOUSE_BUTTON_LEFT)
 	{
-		dvec2 pos; glfwGetCursorPos(window, &pos.x, &pos.y);
+		dvec2 pos = replay().cursor_pos(window);
 		vec2 npos = cursor_to_ndc(pos, window_size);
 		if (action == GLFW_PRESS) {
 			tb.begin(cam.view_matrix, npos);
@@ -250,111 +495,195 @@ bool user_init()
 	// log hotkeys
 	print_help();
 
+	// the same states on the CPU, without any GL object
+	if (raster.b_enabled) {
+		raster.clear_color = vec4(39/255.0f, 40/255.0f, 34/255.0f, 1.0f);	// culling and depth tests are on by default
+		return raster.resize(window_size);
+	}
+
 	// init GL states
 	glClearColor( 39/255.0f, 40/255.0f, 34/255.0f, 1.0f );	// set clear color
 	glEnable( GL_CULL_FACE );								// turn on backface culling
 	glEnable( GL_DEPTH_TEST );								// turn on depth tests
 
 	// create vertex buffer; called again when index buffering mode is toggled
-	update_vertex_buffer(unit_sphere_vertices,0);
+	update_vertex_buffer(lods.vertices,0);
+
+	// attribute-less vertex array, still required by the core profile
+	glGenVertexArrays(1, &empty_array);
+
+	// impostor quads come from gl_VertexID; only the spheres are attributes, advanced once per instance
+	glGenBuffers(1, &impostor_buffer);
+	glGenVertexArrays(1, &impostor_array);
+	glBindVertexArray(impostor_array);
+	glBindBuffer(GL_ARRAY_BUFFER, impostor_buffer);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(sphere_instance), (const void*) 0);
+	glVertexAttribDivisor(0, 1);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(sphere_instance), (const void*) sizeof(vec4));
+	glVertexAttribDivisor(1, 1);
+	glBindVertexArray(0);
+
+	// camera block at its fixed binding point; further programs only need to attach()
+	camera_buffer.create(CAMERA_BINDING);
+	if (!camera_buffer.attach(program, "camera")) { printf("%s(): camera block not found\n", __func__); return false; }
+	if (!camera_buffer.attach(impostor_program, "camera")) { printf("%s(): camera block not found in the impostor program\n", __func__); return false; }
 
 	return true;
 }
 
 void user_finalize()
 {
+	camera_buffer.destroy();
 }
 
-int main( int argc, char* argv[] )
+// camera paths over growing scenes: "--bench-paths [file.csv]" renders headless and writes a row per scene, mode and path
+// each run starts from time 0 and steps the virtual clock of "--fps N"; meshes are skipped above bench_mesh_limit bodies,
+// and impostors with "--software", which draws meshes only
+bool run_path_benchmark(const char* csv, const std::vector<uint>& counts)
 {
-	float phi = 0.0f;
-	float theta = PI;
-	vertex vertex;
-
-	// creating vertices
-	for (int i = 0; i <= 72; i++) {
-		for (int j = 0; j <= 36; j++) {
-			vertex.pos = vec3(sin(theta)*cos(phi),sin(theta)*sin(phi),cos(theta));
-			vertex.norm = vec3(sin(theta) * cos(phi), sin(theta) * sin(phi), cos(theta));
-			vertex.tex = vec2(phi/2/PI, 1-theta/PI);
-			unit_sphere_vertices.emplace_back(vertex);
-			theta -= PI / 36;
+	std::vector<camera_path> paths(sizeof(bench_path_files) / sizeof(bench_path_files[0]));
+	for (size_t k = 0; k < paths.size(); k++) if (!paths[k].load(bench_path_files[k])) return false;
+	FILE* fp = fopen(csv, "w"); if (!fp) { printf("%s(): unable to open %s\n", __func__, csv); return false; }
+	const char* renderer = raster.b_enabled ? "software rasterizer" : (const char*) glGetString(GL_RENDERER);
+	write_path_header(fp, renderer, window_size, 1 / replay().dt);
+	write_path_header(stdout, renderer, window_size, 1 / replay().dt);
+
+	auto solar_system = create_planets();	// the default scene; a count up to its bodies selects it
+	float reference = system_extent(solar_system);
+	for (uint n : counts) {
+		planets = n <= solar_system.size() ? solar_system : create_bodies(n);
+		scene = create_scene(planets); orbits = create_orbits(planets); lod_levels.clear();
+		path_scale = std::max(1.0f, system_extent(planets) / reference);
+		for (int mode = 0; mode < 2; mode++) {
+			b_impostor = mode == 1;
+			if (!b_impostor && planets.size() > bench_mesh_limit) continue;
+			if (b_impostor && raster.b_enabled) continue;	// the software rasterizer would draw the same meshes again
+			for (auto& p : paths) {
+				path = p; world_clock = sim_clock();
+				cam = camera(); cam.dfar *= path_scale;	// the far plane grows with the scene
+
+				// first frames at time 0 to fill the buffers and caches of the scene
+				for (int k = 0; k < bench_warmup_frames; k++) { frame = 0; update(); render(); headless.end_frame(); }
+
+				path_run run; run.path = p.name; run.bodies = uint(planets.size()); run.mode = b_impostor ? "impostor" : "mesh";
+				for (frame = 0; frame * replay().dt <= p.duration; frame++) {
+					prof().begin_frame(frame); gpu_prof().begin_frame(frame);
+					update(); render(); headless.end_frame();
+					gpu_prof().end_frame(); prof().end_frame();
+					run.add(float(headless.frame_times.back() * 1000), drawn.draws, drawn.triangles, drawn.visible);
+				}
+				write_path_run(fp, run); write_path_run(stdout, run); fflush(fp);
+			}
 		}
-		theta = PI;
-		phi += 2 * PI / 72;
 	}
+	fclose(fp);
+	printf("> path benchmark written to %s\n", csv);
+	path = camera_path();
+	return true;
+}
 
-	// creating indices
-	for (int i = 0; i < 72; i++) {
-		for (int j = 0; j < 36; j++) {
-			indices.emplace_back(37 * i + j);
-			indices.emplace_back(37 * (i + 1) + j);
-			indices.emplace_back(37 * (i + 1) + (j + 1));
-
-			indices.emplace_back(37 * i + j);
-			indices.emplace_back(37 * (i + 1) + (j + 1));
-			indices.emplace_back(37 * i + (j + 1));
-		}
+int main( int argc, char* argv[] )
+{
+	// headless benchmark without creating a window
+	if(argc>1&&strcmp(argv[1],"--bench-scene")==0){ run_scene_benchmark( argc>2?uint(atoi(argv[2])):10000 ); return 0; }
+	if(argc>1&&strcmp(argv[1],"--bench-nbody")==0){ run_nbody_benchmark( argc>2?uint(atoi(argv[2])):100000 ); return 0; }
+	if(argc>1&&strcmp(argv[1],"--bench-cull")==0){ run_cull_benchmark( argc>2?uint(atoi(argv[2])):1000000 ); return 0; }
+	if(argc>1&&strcmp(argv[1],"--bench-vertex")==0){ run_vertex_benchmark(); return 0; }
+	if(argc>1&&strcmp(argv[1],"--bench-kepler")==0){ run_kepler_benchmark( argc>2?uint(atoi(argv[2])):100000 ); return 0; }
+	if(argc>1&&strcmp(argv[1],"--bench-energy")==0){ run_energy_benchmark( argc>2?uint(atoi(argv[2])):8, argc>3?atoi(argv[3]):100000 ); return 0; }
+
+	// unit sphere levels from 8x4 to 256x128 in one buffer
+	lods = create_sphere_lods();
+	lods.print_stats();
+
+	// start time and time warp, e.g., "--time 1e7 --warp 100" for a kiosk that has been running for months
+	// "--bodies N" replaces the solar system with a synthetic one of N bodies, e.g., 1000000 for the impostors
+	for (int k = 1; k + 1 < argc; k++) {
+		if (strcmp(argv[k], "--time") == 0) world_clock.base = sim_time = atof(argv[++k]);
+		else if (strcmp(argv[k], "--warp") == 0) world_clock.scale = atof(argv[++k]);
+		else if (strcmp(argv[k], "--bodies") == 0) { planets = create_bodies(uint(atoi(argv[++k]))); scene = create_scene(planets); orbits = create_orbits(planets); }
 	}
 
-	/*
-	phi = 0.0f;
-	theta = PI;
-	float x_displacement = 5.0f;
-	// creating vertices
-	for (int i = 0; i <= 72; i++) {
-		for (int j = 0; j <= 36; j++) {
-			vertex.pos = vec3(sin(theta) * cos(phi) + x_displacement, sin(theta) * sin(phi), cos(theta));
-			vertex.norm = vec3(sin(theta) * cos(phi), sin(theta) * sin(phi), cos(theta));
-			vertex.tex = vec2(phi / 2 / PI, 1 - theta / PI);
-			unit_sphere_vertices.emplace_back(vertex);
-			theta -= PI / 36;
+	// "--path file" drives the camera instead of the mouse until the path ends
+	// "--bench-paths [file.csv]" runs every path of bench_path_files over the scenes of "--bench-bodies 11,1000,10000,100000",
+	// where the first is the default solar system of the sun, 7 planets and their moons
+	const char* bench_csv = nullptr;
+	std::vector<uint> bench_bodies = { uint(create_planets().size()), 1000, 10000, 100000 };
+	for (int k = 1; k < argc; k++) {
+		if (strcmp(argv[k], "--path") == 0 && k + 1 < argc) { if (!path.load(argv[++k])) return 1; }
+		else if (strcmp(argv[k], "--bench-paths") == 0) bench_csv = k + 1 < argc && argv[k + 1][0] != '-' ? argv[++k] : "paths.csv";
+		else if (strcmp(argv[k], "--bench-bodies") == 0 && k + 1 < argc) {
+			bench_bodies.clear();
+			for (char* c = argv[++k]; *c; c++) { bench_bodies.push_back(uint(strtoul(c, &c, 10))); if (*c != ',') break; }
 		}
-		theta = PI;
-		phi += 2 * PI / 72;
 	}
-
-	// creating indices
-	for (int i = 0; i < 72; i++) {
-		for (int j = 0; j < 36; j++) {
-			indices.emplace_back(73*37 + 37 * i + j);
-			indices.emplace_back(73 * 37 + 37 * (i + 1) + j);
-			indices.emplace_back(73 * 37 + 37 * (i + 1) + (j + 1));
-
-			indices.emplace_back(73 * 37 + 37 * i + j);
-			indices.emplace_back(73 * 37 + 37 * (i + 1) + (j + 1));
-			indices.emplace_back(73 * 37 + 37 * i + (j + 1));
-		}
+	if (!path.empty()) {
+		path_scale = std::max(1.0f, system_extent(planets) / system_extent(create_planets()));
+		cam.dfar *= path_scale;
+		printf("> camera on %s for %g seconds\n", path.name.c_str(), path.duration);
 	}
-	*/
-
-
 
-	// create window and initialize OpenGL extensions
-	if(!(window = cg_create_window( window_name, window_size.x, window_size.y ))){ glfwTerminate(); return 1; }
-	if(!cg_init_extensions( window )){ glfwTerminate(); return 1; }	// version and extensions
+	// "--record file" or "--replay file"; a replay restores the window size of the recording
+	if(!replay().parse( argc, argv )) return 1;
+	if(replay().mode==INPUT_REPLAY) window_size = replay().size;
+
+	// create window and initialize OpenGL extensions, or an offscreen context for "--headless [frames]"
+	headless.size = window_size; headless.parse( argc, argv );
+	prof().parse( argc, argv );	// "--profile [prefix]" for the zones and their trace
+	raster.parse( argc, argv ); if(raster.b_enabled) headless.b_enabled = headless.b_software = true;	// "--software" is always offscreen
+	if(replay().mode==INPUT_REPLAY) headless.frames = replay().frames;
+	else if(!path.empty()) headless.frames = int(path.duration/replay().dt)+1;
+	if(bench_csv) headless.b_enabled = true;	// always offscreen
+	replay().size = window_size;	// header of a recording
+	if(headless.b_enabled){ window_size = headless.size; if(!headless.create( window_name, window )){ glfwTerminate(); return 1; } }
+	else
+	{
+		if(!(window = cg_create_window( window_name, window_size.x, window_size.y ))){ glfwTerminate(); return 1; }
+		if(!cg_init_extensions( window )){ glfwTerminate(); return 1; }	// version and extensions
+	}
 
-	// initializations and validations
-	if(!(program=cg_create_program( vert_shader_path, frag_shader_path ))){ glfwTerminate(); return 1; }	// create and compile shaders/program
+	// initializations and validations; the software rasterizer needs no programs
+	if(!raster.b_enabled)
+	{
+		if(!(program=cg_create_program( vert_shader_path, frag_shader_path ))){ glfwTerminate(); return 1; }	// create and compile shaders/program
+		if(!(impostor_program=cg_create_program( impostor_vert_shader_path, impostor_frag_shader_path ))){ glfwTerminate(); return 1; }
+		uniforms.reflect( program );
+		u.model_matrix = uniforms.get<mat4>( "model_matrix" );
+		u.vertex_format = uniforms.get<uint>( "vertex_format" );
+		u.sphere_slices = uniforms.get<uint>( "sphere_slices" );
+		u.sphere_stacks = uniforms.get<uint>( "sphere_stacks" );
+		u.b_procedural = uniforms.get<int>( "b_procedural" );
+	}
 	if(!user_init()){ printf( "Failed to user_init()\n" ); glfwTerminate(); return 1; }					// user initialization
+	if(!raster.b_enabled) gpu_prof().create();	// timer queries when profiling
 
-	// register event callbacks
-	glfwSetWindowSizeCallback( window, reshape );	// callback for window resizing events
-    glfwSetKeyCallback( window, keyboard );			// callback for keyboard events
-	glfwSetMouseButtonCallback( window, mouse );	// callback for mouse click inputs
-	glfwSetCursorPosCallback( window, motion );		// callback for mouse movement
+	// register event callbacks for window resizing, keyboard, mouse click inputs and mouse movement;
+	// they are called through the recorder, which also feeds them a replay
+	replay().set_callbacks( window, reshape, keyboard, mouse, motion );
 
-	// enters rendering/event loop
-	for( frame=0; !glfwWindowShouldClose(window); frame++ )
+	// enters rendering/event loop; the path benchmark renders its own frames instead
+	headless.start();	// setup is not part of the measured frames
+	bool b_bench = true;
+	if(bench_csv) b_bench = run_path_benchmark( bench_csv, bench_bodies );
+	else for( frame=0; headless.b_enabled ? headless.running(frame) : !glfwWindowShouldClose(window)&&replay().running(frame)&&(path.empty()||frame*replay().dt<=path.duration); frame++ )
 	{
-		glfwPollEvents();	// polling and processing of events
+		prof().begin_frame( frame ); gpu_prof().begin_frame( frame );
+		{ profile_zone zone( "input" ); replay().poll( window, frame ); }	// polling and processing of events, live or replayed
 		update();			// per-frame update
 		render();			// per-frame render
+		if(headless.b_enabled) headless.end_frame();
+		gpu_prof().end_frame(); prof().end_frame();
 	}
 
 	// normal termination
+	replay().save( frame );	// when recording
+	gpu_prof().destroy();
+	prof().finish();	// frame-time percentiles and the trace files
 	user_finalize();
-	cg_destroy_window(window);
+	headless.finish( raster.b_enabled ? raster.rgb().data() : nullptr );	// stats and the last frame, then the offscreen context
+	if(window) cg_destroy_window(window);
 
-	return 0;
+	return b_bench ? 0 : 1;
 }
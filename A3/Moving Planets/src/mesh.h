@@ -0,0 +1,253 @@
+#pragma once
+#ifndef __MESH_H__
+#define __MESH_H__
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+#include "cgmath.h"
+#include "cgut.h"		// vertex
+#include "thread_pool.h"
+#include "mesh_opt.h"
+
+//*************************************
+// indexed triangle mesh of a unit sphere; positions double as normals
+struct mesh
+{
+	std::vector<vertex>	vertices;
+	std::vector<uint>	indices;
+	mesh_stats			naive, optimized;	// cache efficiency before and after optimize_mesh()
+};
+
+enum sphere_kind { UV_SPHERE=0, ICOSPHERE, CUBE_SPHERE, NUM_SPHERE_KINDS };
+static const char* sphere_kind_names[] = { "uv sphere", "icosphere", "cube sphere" };
+
+// meshes with fewer vertices than this are generated on the calling thread
+static const size_t MESH_PARALLEL_VERTICES = 65536;
+
+inline vertex sphere_vertex( vec3 p, vec2 tc ){ return { p, p, tc }; }
+
+// spherical texture coordinates of a point on the unit sphere, as in the UV sphere
+inline vec2 sphere_texcoord( vec3 p )
+{
+	float phi = atan2(p.y,p.x); if(phi<0) phi += 2*PI;
+	return vec2( phi/2/PI, 1-acos(std::max(-1.0f,std::min(1.0f,p.z)))/PI );
+}
+
+//*************************************
+// (slices+1) columns of (stacks+1) vertices from the south pole (theta=PI) to the north pole
+// sin/cos are tabulated once per ring and per column instead of per vertex
+inline mesh create_uv_sphere( uint slices, uint stacks )
+{
+	mesh m;
+	uint column = stacks+1;
+	std::vector<float> sp(slices+1), cp(slices+1), st(column), ct(column);
+	for( uint i=0; i <= slices; i++ ){ float phi = 2*PI*i/float(slices); sp[i] = sin(phi); cp[i] = cos(phi); }
+	for( uint j=0; j <= stacks; j++ ){ float theta = PI-PI*j/float(stacks); st[j] = sin(theta); ct[j] = cos(theta); }
+
+	m.vertices.resize( size_t(slices+1)*column );
+	m.indices.resize( size_t(slices)*stacks*6 );
+	uint tasks = m.vertices.size()<MESH_PARALLEL_VERTICES ? 1 : default_thread_pool().size();
+	parallel_for( tasks, slices+1, 1, [&]( size_t begin, size_t end )
+	{
+		for( size_t i=begin; i < end; i++ )
+		{
+			for( uint j=0; j <= stacks; j++ )
+				m.vertices[i*column+j] = sphere_vertex( vec3(st[j]*cp[i],st[j]*sp[i],ct[j]), vec2(i/float(slices),j/float(stacks)) );
+			if(i==slices) continue;
+
+			uint* idx = &m.indices[i*stacks*6];
+			for( uint j=0; j < stacks; j++ )
+			{
+				uint a = uint(i)*column+j, b = a+column;
+				*idx++ = a;	*idx++ = b;	*idx++ = b+1;
+				*idx++ = a;	*idx++ = b+1;	*idx++ = a+1;
+			}
+		}
+	});
+	return m;
+}
+
+//*************************************
+// geodesic sphere: every face of an icosahedron split into n*n triangles and projected to the sphere
+// shared vertices have fixed indices (12 corners, n-1 per edge, the rest per face), so the faces are
+// generated in parallel without welding; the vertices on the texture seam and the poles are split afterward
+inline mesh create_icosphere( uint n )
+{
+	static const float t = 1.618034f;	// golden ratio
+	static const vec3 corners[12] = { {-1,t,0},{1,t,0},{-1,-t,0},{1,-t,0},{0,-1,t},{0,1,t},{0,-1,-t},{0,1,-t},{t,0,-1},{t,0,1},{-t,0,-1},{-t,0,1} };
+	static const uint faces[20][3] = { {0,11,5},{0,5,1},{0,1,7},{0,7,10},{0,10,11},{1,5,9},{5,11,4},{11,10,2},{10,7,6},{7,1,8},
+		{3,9,4},{3,4,2},{3,2,6},{3,6,8},{3,8,9},{4,9,5},{2,4,11},{6,2,10},{8,6,7},{9,8,1} };
+
+	n = std::max(1u,n);
+	mesh m;
+
+	// edges in the order of their first appearance; each stored from the lower to the higher corner
+	std::map<std::pair<uint,uint>,uint> edge_of;
+	std::vector<std::pair<uint,uint>> edges;
+	for( auto& f : faces ) for( int k=0; k < 3; k++ )
+	{
+		uint a = std::min(f[k],f[(k+1)%3]), b = std::max(f[k],f[(k+1)%3]);
+		if(edge_of.emplace(std::make_pair(a,b),uint(edges.size())).second) edges.push_back({a,b});
+	}
+
+	uint edge_base = 12, face_base = edge_base+30*(n-1), per_face = n>2 ? (n-1)*(n-2)/2 : 0;
+	m.vertices.resize( face_base+20*per_face );
+	m.indices.resize( 20*n*n*3 );
+	auto project = []( vec3 p ){ p = p.normalize(); return sphere_vertex( p, sphere_texcoord(p) ); };
+	auto lerp3 = []( vec3 a, vec3 b, float s ){ return a*(1-s)+b*s; };
+
+	for( uint k=0; k < 12; k++ ) m.vertices[k] = project( corners[k] );
+	for( uint e=0; e < 30; e++ )
+		for( uint s=1; s < n; s++ ) m.vertices[edge_base+e*(n-1)+s-1] = project( lerp3(corners[edges[e].first],corners[edges[e].second],s/float(n)) );
+
+	// index of the vertex at step s from corner a toward corner b
+	auto on_edge = [&]( uint a, uint b, uint s ) -> uint
+	{
+		if(s==0) return a;
+		if(s==n) return b;
+		uint e = edge_of.at({std::min(a,b),std::max(a,b)});
+		return edge_base+e*(n-1)+(a<b ? s : n-s)-1;
+	};
+
+	uint tasks = m.vertices.size()<MESH_PARALLEL_VERTICES ? 1 : default_thread_pool().size();
+	parallel_for( tasks, 20, 1, [&]( size_t begin, size_t end )
+	{
+		std::vector<uint> local( size_t(n+1)*(n+1) );	// vertex index of (i,j) with i+j <= n
+		for( size_t f=begin; f < end; f++ )
+		{
+			uint A = faces[f][0], B = faces[f][1], C = faces[f][2];
+			uint next = face_base+uint(f)*per_face;
+			for( uint j=0; j <= n; j++ ) for( uint i=0; i+j <= n; i++ )
+			{
+				uint& v = local[j*(n+1)+i];
+				if(j==0)		v = on_edge(A,B,i);
+				else if(i==0)	v = on_edge(A,C,j);
+				else if(i+j==n)	v = on_edge(B,C,j);
+				else
+				{
+					vec3 p = corners[A]+(corners[B]-corners[A])*(i/float(n))+(corners[C]-corners[A])*(j/float(n));
+					m.vertices[v=next++] = project(p);
+				}
+			}
+
+			uint* idx = &m.indices[f*n*n*3];
+			for( uint j=0; j < n; j++ ) for( uint i=0; i+j < n; i++ )
+			{
+				uint a = local[j*(n+1)+i], b = local[j*(n+1)+i+1], c = local[(j+1)*(n+1)+i];
+				*idx++ = a; *idx++ = b; *idx++ = c;
+				if(i+j+1 < n){ uint d = local[(j+1)*(n+1)+i+1]; *idx++ = b; *idx++ = d; *idx++ = c; }
+			}
+		}
+	});
+
+	// seam fix-up: a triangle across the u=1->0 seam gets copies of its low-u vertices with u+1,
+	// and a pole vertex, whose u is arbitrary, takes the mean u of the other two per triangle
+	std::vector<uint> wrapped( m.vertices.size(), uint(-1) );
+	std::vector<bool> pole_used( m.vertices.size(), false );
+	for( size_t tri=0; tri < m.indices.size(); tri+=3 )
+	{
+		uint* f = &m.indices[tri];
+		bool pole[3]; float umin=1, umax=0;
+		for( int k=0; k < 3; k++ )
+		{
+			const vec3& p = m.vertices[f[k]].pos;
+			pole[k] = fabs(p.x)<1e-6f && fabs(p.y)<1e-6f;
+			if(!pole[k]){ umin = std::min(umin,m.vertices[f[k]].tex.x); umax = std::max(umax,m.vertices[f[k]].tex.x); }
+		}
+		if(umax-umin>0.5f) for( int k=0; k < 3; k++ )
+		{
+			if(pole[k]||m.vertices[f[k]].tex.x>=0.5f) continue;
+			if(wrapped[f[k]]==uint(-1)){ vertex v = m.vertices[f[k]]; v.tex.x += 1; wrapped[f[k]] = uint(m.vertices.size()); m.vertices.push_back(v); }
+			f[k] = wrapped[f[k]];
+		}
+		for( int k=0; k < 3; k++ )
+		{
+			if(!pole[k]) continue;
+			float u = (m.vertices[f[(k+1)%3]].tex.x+m.vertices[f[(k+2)%3]].tex.x)/2;
+			if(pole_used[f[k]]){ vertex v = m.vertices[f[k]]; v.tex.x = u; f[k] = uint(m.vertices.size()); m.vertices.push_back(v); }
+			else { pole_used[f[k]] = true; m.vertices[f[k]].tex.x = u; }
+		}
+	}
+	return m;
+}
+
+//*************************************
+// cube with every face split into n*n quads, projected to the sphere with the area-preserving mapping
+// the faces have their own vertices and texture coordinates in [0,1]^2, as for a cube map
+inline mesh create_cube_sphere( uint n )
+{
+	static const vec3 axes[6][3] = {	// normal, u and v of each face; u x v = normal
+		{{1,0,0},{0,1,0},{0,0,1}}, {{-1,0,0},{0,0,1},{0,1,0}}, {{0,1,0},{0,0,1},{1,0,0}},
+		{{0,-1,0},{1,0,0},{0,0,1}}, {{0,0,1},{1,0,0},{0,1,0}}, {{0,0,-1},{0,1,0},{1,0,0}} };
+
+	n = std::max(1u,n);
+	mesh m;
+	uint row = n+1, per_face = row*row;
+	std::vector<float> grid(row);	// sin/cos-free counterpart of the ring tables: one coordinate per row
+	for( uint k=0; k <= n; k++ ) grid[k] = -1+2*k/float(n);
+	m.vertices.resize( size_t(6)*per_face );
+	m.indices.resize( size_t(6)*n*n*6 );
+
+	uint tasks = m.vertices.size()<MESH_PARALLEL_VERTICES ? 1 : default_thread_pool().size();
+	parallel_for( tasks, size_t(6)*row, 1, [&]( size_t begin, size_t end )
+	{
+		for( size_t r=begin; r < end; r++ )
+		{
+			uint f = uint(r/row), j = uint(r%row);
+			const vec3 *a = axes[f];
+			for( uint i=0; i <= n; i++ )
+			{
+				vec3 c = a[0]+a[1]*grid[i]+a[2]*grid[j];
+				float x2 = c.x*c.x, y2 = c.y*c.y, z2 = c.z*c.z;
+				vec3 p = vec3( c.x*sqrt(1-y2/2-z2/2+y2*z2/3), c.y*sqrt(1-z2/2-x2/2+z2*x2/3), c.z*sqrt(1-x2/2-y2/2+x2*y2/3) );
+				m.vertices[f*per_face+j*row+i] = sphere_vertex( p, vec2(i/float(n),j/float(n)) );
+			}
+			if(j==n) continue;
+
+			uint* idx = &m.indices[(size_t(f)*n+j)*n*6];
+			for( uint i=0; i < n; i++ )
+			{
+				uint v = f*per_face+j*row+i;
+				*idx++ = v;	*idx++ = v+1;	*idx++ = v+row+1;
+				*idx++ = v;	*idx++ = v+row+1;	*idx++ = v+row;
+			}
+		}
+	});
+	return m;
+}
+
+//*************************************
+// reorder the triangles for the post-transform cache, then the vertices for fetch locality
+inline void optimize_mesh( mesh& m )
+{
+	m.naive = analyze_vertex_cache( m.indices.data(), m.indices.size(), m.vertices.size() );
+	std::vector<uint> naive = m.indices;
+	optimize_vertex_cache( m.indices.data(), m.indices.size(), m.vertices.size() );
+	m.optimized = analyze_vertex_cache( m.indices.data(), m.indices.size(), m.vertices.size() );
+	if(m.optimized.acmr>m.naive.acmr){ m.indices.swap(naive); m.optimized = m.naive; }	// tiny meshes may already be better in row order
+	optimize_vertex_fetch( m.vertices, m.indices.data(), m.indices.size() );
+}
+
+//*************************************
+// meshes by kind and resolution, optimized by optimize_mesh(); a mesh is generated once and shared afterward
+// res is (slices, stacks) for the UV sphere and (subdivisions, -) for the others
+inline std::shared_ptr<const mesh> get_sphere_mesh( sphere_kind kind, uint res0, uint res1=0 )
+{
+	static std::map<std::tuple<int,uint,uint>,std::shared_ptr<const mesh>> cache;
+	static std::mutex mtx;
+	if(kind!=UV_SPHERE) res1 = 0;
+
+	std::lock_guard<std::mutex> lock(mtx);
+	auto& m = cache[std::make_tuple(int(kind),res0,res1)];
+	if(!m)
+	{
+		mesh g = kind==UV_SPHERE ? create_uv_sphere(res0,res1) : kind==ICOSPHERE ? create_icosphere(res0) : create_cube_sphere(res0);
+		optimize_mesh( g );
+		m = std::make_shared<const mesh>( std::move(g) );
+	}
+	return m;
+}
+
+#endif // __MESH_H__
@@ -0,0 +1,334 @@
+#pragma once
+#ifndef __NBODY_H__
+#define __NBODY_H__
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "cgmath.h"		// no GL or GLFW dependency below this point
+#include "thread_pool.h"
+
+//*************************************
+// structure-of-arrays storage of the gravitating bodies
+struct body_store
+{
+	std::vector<float>	x, y, z;		// positions
+	std::vector<float>	vx, vy, vz;		// velocities
+	std::vector<float>	ax, ay, az;		// accelerations of the current positions
+	std::vector<float>	mass;
+
+	size_t	size() const { return x.size(); }
+	void	reserve( size_t n ){ for( auto* v : { &x,&y,&z,&vx,&vy,&vz,&ax,&ay,&az,&mass } ) v->reserve(n); }
+	void	push_back( vec3 p, vec3 v, float m );
+	vec3	position( size_t k ) const { return vec3(x[k],y[k],z[k]); }
+};
+
+inline void body_store::push_back( vec3 p, vec3 v, float m )
+{
+	x.push_back(p.x); y.push_back(p.y); z.push_back(p.z);
+	vx.push_back(v.x); vy.push_back(v.y); vz.push_back(v.z);
+	ax.push_back(0); ay.push_back(0); az.push_back(0);
+	mass.push_back(m);
+}
+
+//*************************************
+// Barnes-Hut octree built over Morton-sorted bodies
+// the children of a node are contiguous, and the bodies of a node are a contiguous range of order
+struct octree_node
+{
+	float	cx, cy, cz, mass;	// center of mass and total mass
+	float	ox, oy, oz, half;	// center and half width of the cell
+	int		first;				// first child node; -1 for a leaf
+	int		children;			// number of non-empty children
+	int		begin, end;			// range of the bodies in order
+};
+
+struct octree
+{
+	static const int	LEAF_SIZE = 8;		// bodies of a leaf, summed directly
+	static const int	MAX_DEPTH = 21;		// bits per axis of the Morton codes
+
+	std::vector<octree_node>	nodes;		// the root is nodes[0]
+	std::vector<int>			order;		// body indices sorted along the Morton curve
+	std::vector<uint64_t>		keys;		// Morton codes of the bodies in order
+
+	void	build( const body_store& b, uint threads=1 );
+
+private:
+	void	build_node( const body_store& b, int k, int begin, int end, int depth );
+};
+
+// spread the lower 21 bits of v to every third bit
+inline uint64_t morton_spread( uint64_t v )
+{
+	v &= 0x1fffff;
+	v = (v|v<<32)&0x1f00000000ffffull;
+	v = (v|v<<16)&0x1f0000ff0000ffull;
+	v = (v|v<<8)&0x100f00f00f00f00full;
+	v = (v|v<<4)&0x10c30c30c30c30c3ull;
+	v = (v|v<<2)&0x1249249249249249ull;
+	return v;
+}
+
+inline void octree::build( const body_store& b, uint threads )
+{
+	int n = int(b.size());
+	nodes.clear(); order.resize(n); keys.resize(n);
+	if(n==0) return;
+
+	// bounding cube
+	float lo[3] = { b.x[0], b.y[0], b.z[0] }, hi[3] = { b.x[0], b.y[0], b.z[0] };
+	for( int k=1; k < n; k++ )
+	{
+		lo[0] = std::min(lo[0],b.x[k]); hi[0] = std::max(hi[0],b.x[k]);
+		lo[1] = std::min(lo[1],b.y[k]); hi[1] = std::max(hi[1],b.y[k]);
+		lo[2] = std::min(lo[2],b.z[k]); hi[2] = std::max(hi[2],b.z[k]);
+	}
+	float half = std::max(std::max(hi[0]-lo[0],hi[1]-lo[1]),hi[2]-lo[2])*0.5f*1.0001f+1e-6f;
+	float ox = (lo[0]+hi[0])*0.5f, oy = (lo[1]+hi[1])*0.5f, oz = (lo[2]+hi[2])*0.5f;
+
+	// Morton codes in the cube; ties are broken by the index, so the order does not depend on the sort
+	float scale = float(1<<MAX_DEPTH)/(2*half);
+	parallel_for( threads, size_t(n), 16384, [&]( size_t begin, size_t end )
+	{
+		for( size_t k=begin; k < end; k++ )
+		{
+			uint64_t qx = uint64_t(std::min(float((1<<MAX_DEPTH)-1),(b.x[k]-ox+half)*scale));
+			uint64_t qy = uint64_t(std::min(float((1<<MAX_DEPTH)-1),(b.y[k]-oy+half)*scale));
+			uint64_t qz = uint64_t(std::min(float((1<<MAX_DEPTH)-1),(b.z[k]-oz+half)*scale));
+			keys[k] = morton_spread(qx)<<2|morton_spread(qy)<<1|morton_spread(qz);
+			order[k] = int(k);
+		}
+	});
+	std::sort( order.begin(), order.end(), [&]( int i, int j ){ return keys[i]<keys[j]||(keys[i]==keys[j]&&i<j); } );
+	std::vector<uint64_t> sorted(n);
+	for( int k=0; k < n; k++ ) sorted[k] = keys[order[k]];
+	keys.swap(sorted);
+
+	nodes.reserve( size_t(n)/2+1 );
+	nodes.push_back({});
+	nodes[0].ox = ox; nodes[0].oy = oy; nodes[0].oz = oz; nodes[0].half = half;
+	build_node( b, 0, 0, n, 0 );
+}
+
+inline void octree::build_node( const body_store& b, int k, int begin, int end, int depth )
+{
+	nodes[k].begin = begin; nodes[k].end = end;
+	nodes[k].first = -1; nodes[k].children = 0;
+
+	if(end-begin<=LEAF_SIZE||depth==MAX_DEPTH)
+	{
+		double m = 0, cx = 0, cy = 0, cz = 0;
+		for( int a=begin; a < end; a++ ){ int i = order[a]; float mi = b.mass[i]; m += mi; cx += mi*b.x[i]; cy += mi*b.y[i]; cz += mi*b.z[i]; }
+		octree_node& n = nodes[k];
+		n.mass = float(m);
+		if(m>0){ n.cx = float(cx/m); n.cy = float(cy/m); n.cz = float(cz/m); }
+		else { n.cx = n.ox; n.cy = n.oy; n.cz = n.oz; }
+		return;
+	}
+
+	// split the sorted range by the three bits of this depth; the children are allocated contiguously
+	int shift = 3*(MAX_DEPTH-1-depth), split[9] = { begin }, first = int(nodes.size()), children = 0;
+	for( int o=0; o < 8; o++ )
+		split[o+1] = int( std::upper_bound( keys.begin()+split[o], keys.begin()+end, uint64_t(o), [&]( uint64_t v, uint64_t key ){ return v < ((key>>shift)&7); } ) - keys.begin() );
+	for( int o=0; o < 8; o++ ) if(split[o+1]>split[o]) children++;
+	nodes.resize( nodes.size()+children );
+	nodes[k].first = first; nodes[k].children = children;
+
+	float h = nodes[k].half*0.5f;
+	for( int o=0, c=first; o < 8; o++ )
+	{
+		if(split[o+1]==split[o]) continue;
+		nodes[c].ox = nodes[k].ox+((o&4)?h:-h);
+		nodes[c].oy = nodes[k].oy+((o&2)?h:-h);
+		nodes[c].oz = nodes[k].oz+((o&1)?h:-h);
+		nodes[c].half = h;
+		build_node( b, c, split[o], split[o+1], depth+1 );
+		c++;
+	}
+
+	// monopole of the children
+	double m = 0, cx = 0, cy = 0, cz = 0;
+	for( int c=first; c < first+children; c++ ){ const octree_node& n = nodes[c]; m += n.mass; cx += double(n.mass)*n.cx; cy += double(n.mass)*n.cy; cz += double(n.mass)*n.cz; }
+	octree_node& n = nodes[k];
+	n.mass = float(m);
+	if(m>0){ n.cx = float(cx/m); n.cy = float(cy/m); n.cz = float(cz/m); }
+	else { n.cx = n.ox; n.cy = n.oy; n.cz = n.oz; }
+}
+
+//*************************************
+// self-gravitating bodies advanced with kick-drift-kick leapfrog at a fixed step
+// forces come from the octree (theta>0) or from the direct O(N^2) sum (theta==0)
+struct nbody_system
+{
+	body_store	bodies;
+	float	G = 1.0f;				// gravitational constant
+	float	eps = 0.01f;			// Plummer softening length
+	float	theta = 0.5f;			// opening angle; 0 for the direct sum
+	float	dt = 1/240.0f;			// fixed simulation step in seconds
+	int		max_steps = 16;			// upper bound of steps per advance()
+	float	accumulator = 0.0f;		// elapsed time not simulated yet
+	size_t	steps = 0;				// number of simulated steps
+	size_t	interactions = 0;		// body-body and body-node interactions of the last force pass
+	uint	threads = std::max(1u,std::thread::hardware_concurrency());	// tasks per parallel stage; results do not depend on it
+	octree	tree;
+
+	void	compute_forces();
+	void	compute_forces_direct( const std::vector<int>& targets, std::vector<vec3>& acc ) const;
+	void	step();
+	int		advance( float elapsed );
+	double	energy() const;			// kinetic + potential with the direct sum; O(N^2)
+	void	invalidate(){ b_forces = false; }	// call after changing the bodies from outside
+
+private:
+	bool	b_forces = false;		// are the accelerations of the current positions valid?
+	vec3	tree_acceleration( int i, size_t& count ) const;
+};
+
+inline vec3 nbody_system::tree_acceleration( int i, size_t& count ) const
+{
+	const body_store& b = bodies;
+	float xi = b.x[i], yi = b.y[i], zi = b.z[i], ax = 0, ay = 0, az = 0;
+	float eps2 = eps*eps, theta2 = theta*theta;
+	int stack[8*octree::MAX_DEPTH+8], top = 0;
+	stack[top++] = 0;
+	while(top)
+	{
+		const octree_node& n = tree.nodes[stack[--top]];
+		float dx = n.cx-xi, dy = n.cy-yi, dz = n.cz-zi, d2 = dx*dx+dy*dy+dz*dz;
+		float size = 2*n.half;
+		bool b_inside = fabsf(xi-n.ox)<=n.half&&fabsf(yi-n.oy)<=n.half&&fabsf(zi-n.oz)<=n.half;
+		if(n.first>=0&&(b_inside||size*size>=theta2*d2))
+		{
+			for( int c=n.first; c < n.first+n.children; c++ ) stack[top++] = c;
+			continue;
+		}
+		if(n.first<0&&(b_inside||size*size>=theta2*d2))
+		{
+			// a near leaf: direct sum without self-interaction
+			for( int a=n.begin; a < n.end; a++ )
+			{
+				int j = tree.order[a]; if(j==i) continue;
+				float ex = b.x[j]-xi, ey = b.y[j]-yi, ez = b.z[j]-zi, r2 = ex*ex+ey*ey+ez*ez+eps2;
+				float s = b.mass[j]/(r2*sqrtf(r2));
+				ax += s*ex; ay += s*ey; az += s*ez;
+				count++;
+			}
+			continue;
+		}
+
+		// far enough: the monopole of the whole cell
+		float r2 = d2+eps2, s = n.mass/(r2*sqrtf(r2));
+		ax += s*dx; ay += s*dy; az += s*dz;
+		count++;
+	}
+	return vec3(ax,ay,az)*G;
+}
+
+inline void nbody_system::compute_forces()
+{
+	body_store& b = bodies;
+	size_t n = b.size();
+	if(theta<=0)
+	{
+		std::vector<int> all(n); for( size_t k=0; k < n; k++ ) all[k] = int(k);
+		std::vector<vec3> acc; compute_forces_direct( all, acc );
+		for( size_t k=0; k < n; k++ ){ b.ax[k] = acc[k].x; b.ay[k] = acc[k].y; b.az[k] = acc[k].z; }
+		interactions = n*(n-1);
+		b_forces = true;
+		return;
+	}
+
+	// walk the bodies along the Morton curve, so that neighbouring tasks traverse similar parts of the tree
+	tree.build( b, threads );
+	std::atomic<size_t> total(0);
+	parallel_for( threads, n, 1024, [&]( size_t begin, size_t end )
+	{
+		size_t count = 0;
+		for( size_t a=begin; a < end; a++ )
+		{
+			int i = tree.order[a];
+			vec3 acc = tree_acceleration( i, count );
+			b.ax[i] = acc.x; b.ay[i] = acc.y; b.az[i] = acc.z;
+		}
+		total += count;
+	});
+	interactions = total;
+	b_forces = true;
+}
+
+// reference accelerations of the target bodies by the direct sum over all bodies
+inline void nbody_system::compute_forces_direct( const std::vector<int>& targets, std::vector<vec3>& acc ) const
+{
+	const body_store& b = bodies;
+	size_t n = b.size();
+	acc.resize( targets.size() );
+	float eps2 = eps*eps;
+	parallel_for( threads, targets.size(), 64, [&]( size_t begin, size_t end )
+	{
+		for( size_t t=begin; t < end; t++ )
+		{
+			int i = targets[t];
+			float xi = b.x[i], yi = b.y[i], zi = b.z[i], ax = 0, ay = 0, az = 0;
+			for( size_t j=0; j < n; j++ )
+			{
+				float dx = b.x[j]-xi, dy = b.y[j]-yi, dz = b.z[j]-zi, r2 = dx*dx+dy*dy+dz*dz+eps2;
+				float s = int(j)==i ? 0.0f : b.mass[j]/(r2*sqrtf(r2));
+				ax += s*dx; ay += s*dy; az += s*dz;
+			}
+			acc[t] = vec3(ax,ay,az)*G;
+		}
+	});
+}
+
+inline void nbody_system::step()
+{
+	body_store& b = bodies;
+	if(!b_forces) compute_forces();
+
+	// kick and drift, then kick again with the forces of the new positions
+	float h = dt*0.5f;
+	parallel_for( threads, b.size(), 16384, [&]( size_t begin, size_t end )
+	{
+		for( size_t k=begin; k < end; k++ )
+		{
+			b.vx[k] += b.ax[k]*h; b.vy[k] += b.ay[k]*h; b.vz[k] += b.az[k]*h;
+			b.x[k] += b.vx[k]*dt; b.y[k] += b.vy[k]*dt; b.z[k] += b.vz[k]*dt;
+		}
+	});
+	compute_forces();
+	parallel_for( threads, b.size(), 16384, [&]( size_t begin, size_t end )
+	{
+		for( size_t k=begin; k < end; k++ ){ b.vx[k] += b.ax[k]*h; b.vy[k] += b.ay[k]*h; b.vz[k] += b.az[k]*h; }
+	});
+	steps++;
+}
+
+inline int nbody_system::advance( float elapsed )
+{
+	// consume the elapsed time in fixed steps; leapfrog is only symplectic at a constant step
+	accumulator += elapsed;
+	int n = 0;
+	for( ; accumulator >= dt && n < max_steps; n++ ){ step(); accumulator -= dt; }
+	if(n==max_steps) accumulator = 0.0f;	// drop the backlog after a long hitch
+	return n;
+}
+
+inline double nbody_system::energy() const
+{
+	const body_store& b = bodies;
+	size_t n = b.size();
+	double kinetic = 0, potential = 0, eps2 = double(eps)*eps;
+	for( size_t i=0; i < n; i++ )
+	{
+		kinetic += 0.5*b.mass[i]*(double(b.vx[i])*b.vx[i]+double(b.vy[i])*b.vy[i]+double(b.vz[i])*b.vz[i]);
+		for( size_t j=i+1; j < n; j++ )
+		{
+			double dx = double(b.x[j])-b.x[i], dy = double(b.y[j])-b.y[i], dz = double(b.z[j])-b.z[i];
+			potential -= double(G)*b.mass[i]*b.mass[j]/sqrt(dx*dx+dy*dy+dz*dz+eps2);
+		}
+	}
+	return kinetic+potential;
+}
+
+#endif // __NBODY_H__
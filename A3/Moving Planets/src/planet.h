@@ -1,6 +1,9 @@
 #pragma once
+#include "scene.h"		// transform hierarchy
+#include "nbody.h"		// gravity simulation
+#include "kepler.h"		// closed-form orbits
 
-#define NUM_OF_PLANETS 8
+#define NUM_OF_PLANETS 8	// the sun and 7 planets; create_planets() adds their moons
 
 struct planet_t
 {
@@ -10,9 +13,11 @@ struct planet_t
 	float	revolution_theta;	// around-rotating angle
 	float   rotation_speed;     // self-rotating speed
 	float   revolution_speed;   // around-rotating speed
+	int		parent = 0;			// index of the body orbited; -1 for the sun
+	float	eccentricity = 0.0f;	// of the orbit; center is the periapsis direction and the semi-major axis
 	mat4	model_matrix;		// modeling transformation
 	// public functions
-	void	update();
+	void	update();			// rebuilds model_matrix from scratch; the scene graph replaces it at run time
 };
 
 inline std::vector<planet_t> create_planets()
@@ -21,33 +26,105 @@ inline std::vector<planet_t> create_planets()
 	planet_t planet;
 	
 	// Set Sun and 7 planets
-	planet = { vec3(0.0f,0.0f,0.0f), 8.0f, 0.0f, 0.0f, 0.5f, 0.0f }; // Sun
+	planet = { vec3(0.0f,0.0f,0.0f), 8.0f, 0.0f, 0.0f, 0.5f, 0.0f, -1 }; // Sun
 	planets.emplace_back(planet);
 
 	planet = { vec3(10.0f,sqrt(14.4f*14.4f - 10.0f*10.0f),0.0f), 1.4f, 0.0f, 0.0f, 1.0f, 1.0f };
 	planets.emplace_back(planet);
 	
-	planet = { vec3(2.0f,-sqrt(20.8f * 20.8f - 2.0f * 2.0f),0.0f), 2.5f, 0.0f, 0.0f, 0.8f, 0.9f };
+	planet = { vec3(2.0f,-sqrt(20.8f * 20.8f - 2.0f * 2.0f),0.0f), 2.5f, 0.0f, 0.0f, 0.8f, 0.9f, 0, 0.1f };
 	planets.emplace_back(planet);
 
 	planet = { vec3(-5.0f,sqrt(28.3f * 28.3f - 5.0f * 5.0f),0.0f), 1.7f, 0.0f, 0.0f, 0.4f, 0.8f };
 	planets.emplace_back(planet);
 
-	planet = { vec3(-15.0f,-sqrt(35.0f * 35.0f - 15.0f * 15.0f),0.0f), 1.8f, 0.0f, 0.0f, 0.5f, 0.7f };
+	planet = { vec3(-15.0f,-sqrt(35.0f * 35.0f - 15.0f * 15.0f),0.0f), 1.8f, 0.0f, 0.0f, 0.5f, 0.7f, 0, 0.08f };
 	planets.emplace_back(planet);
 
 	planet = { vec3(30.0f,sqrt(41.8f * 41.8f - 30.0f * 30.0f),0.0f), 1.5f, 0.0f, 0.0f, 0.3f, 0.6f };
 	planets.emplace_back(planet);
 
-	planet = { vec3(-35.0f,-sqrt(48.3f * 48.3f - 35.0f * 35.0f),0.0f), 1.2f, 0.0f, 0.0f, 0.8f, 0.5f };
+	planet = { vec3(-35.0f,-sqrt(48.3f * 48.3f - 35.0f * 35.0f),0.0f), 1.2f, 0.0f, 0.0f, 0.8f, 0.5f, 0, 0.06f };
 	planets.emplace_back(planet);
 
 	planet = { vec3(17.0f,sqrt(54.5f * 54.5f - 17.0f * 17.0f),0.0f), 0.7f, 0.0f, 0.0f, 0.8f, 0.4f };
 	planets.emplace_back(planet);
 
+	// moons orbiting the planets above, relative to their orbit frames
+	planet = { vec3(3.0f,0.0f,0.0f), 0.4f, 0.0f, 0.0f, 1.0f, 2.0f, 3 };
+	planets.emplace_back(planet);
+
+	planet = { vec3(0.0f,3.2f,0.0f), 0.3f, 0.0f, 0.0f, 1.2f, 2.5f, 4 };
+	planets.emplace_back(planet);
+
+	planet = { vec3(-3.8f,0.0f,0.0f), 0.5f, 0.0f, 0.0f, 0.6f, 1.6f, 4 };
+	planets.emplace_back(planet);
+
 	return planets;
 }
 
+// hierarchy with one node per body in the same order; every parent precedes its children
+inline scene_graph create_scene( const std::vector<planet_t>& planets )
+{
+	scene_graph scene;
+	scene.nodes.reserve(planets.size());
+	for (auto& p : planets) scene.add(p.parent, p.center, p.radius);
+	return scene;
+}
+
+// Kepler orbit of each body around its parent, starting at the periapsis at time 0
+// the revolution speed is the mean motion, so circular orbits match the original revolution
+inline kepler_orbits create_orbits(const std::vector<planet_t>& planets)
+{
+	kepler_orbits orbits;
+	for (auto& p : planets)
+		orbits.push_back(length(vec2(p.center.x, p.center.y)), p.eccentricity, atan2(p.center.y, p.center.x), 0.0, p.revolution_speed, p.center.z);
+	return orbits;
+}
+
+// radius about the sun that contains every orbit at its apoapsis and every body on it; parents precede their children
+inline float system_extent(const std::vector<planet_t>& planets)
+{
+	std::vector<float> reach(planets.size(), 0.0f);
+	float extent = 0.0f;
+	for (size_t k = 0; k < planets.size(); k++) {
+		const planet_t& p = planets[k];
+		reach[k] = (p.parent > 0 ? reach[p.parent] : 0.0f) + length(vec2(p.center.x, p.center.y)) * (1 + p.eccentricity) + fabs(p.center.z);
+		extent = std::max(extent, reach[k] + p.radius);
+	}
+	return extent;
+}
+
+// self-gravitating sun and planets on circular orbits from their current positions in the scene
+// body k is scene node k, since the moons, which are not simulated, follow the sun and planets
+// the sun's mass makes the first planet revolve at its scripted speed; the others follow Kepler's third law
+inline nbody_system create_planet_system(const std::vector<planet_t>& planets, const scene_graph& scene)
+{
+	nbody_system system;
+	float r1 = length(planets[1].center), w1 = planets[1].revolution_speed;
+	float sun_mass = r1 * r1 * r1 * w1 * w1 / system.G;
+
+	vec3 momentum = vec3(0.0f);
+	float total_mass = 0.0f;
+	for (int k = 0; k < int(planets.size()) && planets[k].parent <= 0; k++) {
+		const mat4& m = scene.nodes[k].orbit_matrix;
+		vec3 p = vec3(m._14, m._24, m._34), v = vec3(0.0f);
+		float mass = sun_mass;
+		if (k > 0) {
+			float r = length(vec2(p.x, p.y));
+			v = vec3(-p.y, p.x, 0.0f) * (sqrt(system.G * sun_mass / r) / r);
+			mass = sun_mass * 3e-6f * pow(planets[k].radius / 1.4f, 3.0f);	// earth-like mass ratio at the radius of the first planet
+		}
+		system.bodies.push_back(p, v, mass);
+		momentum += v * mass; total_mass += mass;
+	}
+
+	// remove the drift of the center of mass
+	vec3 drift = momentum / total_mass;
+	for (size_t k = 0; k < system.bodies.size(); k++) { system.bodies.vx[k] -= drift.x; system.bodies.vy[k] -= drift.y; system.bodies.vz[k] -= drift.z; }
+	return system;
+}
+
 inline void planet_t::update()
 {
 
@@ -0,0 +1,201 @@
+#pragma once
+#ifndef __REPLAY_H__
+#define __REPLAY_H__
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "cgmath.h"
+#include "cgut.h"		// GLFW
+
+//*************************************
+// GLFW input events of a session, recorded with "--record file" and fed back with "--replay file"
+// both modes run on a virtual clock of a fixed step per frame ("--fps N", 60 by default), so that a replay,
+// in a window or headless, reproduces the recorded frames without depending on the speed of the machine
+enum input_mode { INPUT_LIVE=0, INPUT_RECORD, INPUT_REPLAY };
+enum input_event_type { INPUT_END=0, INPUT_KEY, INPUT_BUTTON, INPUT_CURSOR, INPUT_SIZE };
+
+struct input_event
+{
+	int		frame;
+	int		type;
+	int		a, b, c, d;		// key, scancode, action, mods; button, action, mods; or width, height
+	dvec2	pos;			// cursor position of INPUT_CURSOR and INPUT_BUTTON
+};
+
+// binary layout, little endian: "CGIR", version, seed, dt, width and height, then the events,
+// each with the frame delta and the type as varints, its integers as zigzag varints, and its position as doubles;
+// INPUT_END carries the number of frames of the session
+static const uint INPUT_FILE_VERSION = 1;
+
+struct input_replay
+{
+	input_mode	mode = INPUT_LIVE;
+	const char*	path = nullptr;
+	double		dt = 1/60.0;	// virtual seconds per frame when recording or replaying
+	uint		seed = 0;		// random seed of the scene, restored by the replay
+	ivec2		size;			// window size at the start
+	int			frame = 0;		// frame being polled
+	int			frames = 0;		// frames of the replayed session
+	dvec2		cursor;			// cursor position in the replay
+	std::vector<input_event>	events;
+	size_t		next = 0;		// next event to replay
+
+	// callbacks of the program; GLFW calls them through the recording or filtering wrappers below
+	GLFWwindowsizefun	on_size = nullptr;
+	GLFWkeyfun			on_key = nullptr;
+	GLFWmousebuttonfun	on_button = nullptr;
+	GLFWcursorposfun	on_cursor = nullptr;
+
+	bool	parse( int argc, char* argv[] );
+	void	set_callbacks( GLFWwindow* window, GLFWwindowsizefun size_fn, GLFWkeyfun key_fn, GLFWmousebuttonfun button_fn, GLFWcursorposfun cursor_fn );
+	void	poll( GLFWwindow* window, int f );
+	double	clock( double wall ) const { return mode==INPUT_LIVE ? wall : frame*dt; }
+	bool	running( int f ) const { return mode!=INPUT_REPLAY||f<frames; }
+	dvec2	cursor_pos( GLFWwindow* window ) const { dvec2 p = cursor; if(mode!=INPUT_REPLAY&&window) glfwGetCursorPos( window, &p.x, &p.y ); return p; }
+	bool	load();
+	bool	save( int num_frames ) const;
+};
+
+inline input_replay& replay(){ static input_replay r; return r; }
+
+//*************************************
+// the wrappers record live events, or drop them while replaying
+inline void replay_size( GLFWwindow* window, int width, int height )
+{
+	input_replay& r = replay(); if(r.mode==INPUT_REPLAY) return;
+	if(r.mode==INPUT_RECORD) r.events.push_back( { r.frame, INPUT_SIZE, width, height, 0, 0, dvec2(0) } );
+	r.on_size( window, width, height );
+}
+
+inline void replay_key( GLFWwindow* window, int key, int scancode, int action, int mods )
+{
+	input_replay& r = replay(); if(r.mode==INPUT_REPLAY) return;
+	if(r.mode==INPUT_RECORD) r.events.push_back( { r.frame, INPUT_KEY, key, scancode, action, mods, dvec2(0) } );
+	r.on_key( window, key, scancode, action, mods );
+}
+
+inline void replay_button( GLFWwindow* window, int button, int action, int mods )
+{
+	input_replay& r = replay(); if(r.mode==INPUT_REPLAY) return;
+	if(r.mode==INPUT_RECORD) r.events.push_back( { r.frame, INPUT_BUTTON, button, action, mods, 0, r.cursor_pos(window) } );
+	r.on_button( window, button, action, mods );
+}
+
+inline void replay_cursor( GLFWwindow* window, double x, double y )
+{
+	input_replay& r = replay(); if(r.mode==INPUT_REPLAY) return;
+	if(r.mode==INPUT_RECORD) r.events.push_back( { r.frame, INPUT_CURSOR, 0, 0, 0, 0, dvec2(x,y) } );
+	r.on_cursor( window, x, y );
+}
+
+//*************************************
+// "--record file", "--replay file", and "--fps N"; a replay restores the seed and the window size of the session
+inline bool input_replay::parse( int argc, char* argv[] )
+{
+	for( int k=1; k+1 < argc; k++ )
+	{
+		if(strcmp(argv[k],"--record")==0){ mode = INPUT_RECORD; path = argv[++k]; }
+		else if(strcmp(argv[k],"--replay")==0){ mode = INPUT_REPLAY; path = argv[++k]; }
+		else if(strcmp(argv[k],"--fps")==0&&atof(argv[k+1])>0) dt = 1/atof(argv[++k]);
+	}
+	if(mode==INPUT_RECORD) printf( "> recording input to %s at %g virtual frames per second\n", path, 1/dt );
+	if(mode==INPUT_REPLAY)
+	{
+		if(!load()) return false;
+		printf( "> replaying %d frames and %zu events of %s at %g virtual frames per second\n", frames, events.size(), path, 1/dt );
+	}
+	return true;
+}
+
+// registers the callbacks of the program through the wrappers; nothing is registered without a window
+inline void input_replay::set_callbacks( GLFWwindow* window, GLFWwindowsizefun size_fn, GLFWkeyfun key_fn, GLFWmousebuttonfun button_fn, GLFWcursorposfun cursor_fn )
+{
+	on_size = size_fn; on_key = key_fn; on_button = button_fn; on_cursor = cursor_fn;
+	if(!window) return;
+	glfwSetWindowSizeCallback( window, replay_size );
+	glfwSetKeyCallback( window, replay_key );
+	glfwSetMouseButtonCallback( window, replay_button );
+	glfwSetCursorPosCallback( window, replay_cursor );
+}
+
+// replaces glfwPollEvents(): live events of the frame, then the recorded ones when replaying
+// resizing is not replayed without a window, since the offscreen framebuffer has a fixed size
+inline void input_replay::poll( GLFWwindow* window, int f )
+{
+	frame = f;
+	if(window) glfwPollEvents();
+	if(mode!=INPUT_REPLAY) return;
+	for( ; next < events.size() && events[next].frame <= f; next++ )
+	{
+		const input_event& e = events[next];
+		if(e.type==INPUT_KEY) on_key( window, e.a, e.b, e.c, e.d );
+		else if(e.type==INPUT_BUTTON){ cursor = e.pos; on_button( window, e.a, e.b, e.c ); }
+		else if(e.type==INPUT_CURSOR){ cursor = e.pos; on_cursor( window, e.pos.x, e.pos.y ); }
+		else if(e.type==INPUT_SIZE&&window) on_size( window, e.a, e.b );
+	}
+}
+
+//*************************************
+inline bool input_replay::save( int num_frames ) const
+{
+	if(mode!=INPUT_RECORD) return true;
+	std::vector<unsigned char> b = { 'C','G','I','R' };
+	auto bytes = [&]( uint64_t v, int n ){ for( int k=0; k < n; k++ ) b.push_back( (unsigned char)(v>>(8*k)) ); };
+	auto varint = [&]( uint64_t v ){ for( ; v >= 0x80; v >>= 7 ) b.push_back( (unsigned char)(v|0x80) ); b.push_back( (unsigned char)v ); };
+	auto zigzag = [&]( int v ){ varint( (uint64_t(int64_t(v))<<1)^uint64_t(int64_t(v)>>63) ); };
+	auto real = [&]( double v ){ uint64_t u; memcpy( &u, &v, 8 ); bytes( u, 8 ); };
+
+	bytes( INPUT_FILE_VERSION, 2 ); bytes( seed, 4 ); real( dt ); bytes( uint(size.x), 2 ); bytes( uint(size.y), 2 );
+	int last = 0;
+	for( auto& e : events )
+	{
+		varint( uint(e.frame-last) ); varint( uint(e.type) ); last = e.frame;
+		if(e.type==INPUT_KEY){ zigzag(e.a); zigzag(e.b); zigzag(e.c); zigzag(e.d); }
+		else if(e.type==INPUT_BUTTON){ zigzag(e.a); zigzag(e.b); zigzag(e.c); real(e.pos.x); real(e.pos.y); }
+		else if(e.type==INPUT_CURSOR){ real(e.pos.x); real(e.pos.y); }
+		else if(e.type==INPUT_SIZE){ zigzag(e.a); zigzag(e.b); }
+	}
+	varint( uint(num_frames-last) ); varint( INPUT_END );
+
+	FILE* fp = fopen( path, "wb" ); if(!fp){ printf( "%s(): unable to open %s\n", __func__, path ); return false; }
+	fwrite( b.data(), 1, b.size(), fp ); fclose( fp );
+	printf( "> %zu events of %d frames recorded to %s (%zu bytes)\n", events.size(), num_frames, path, b.size() );
+	return true;
+}
+
+inline bool input_replay::load()
+{
+	FILE* fp = fopen( path, "rb" ); if(!fp){ printf( "%s(): unable to open %s\n", __func__, path ); return false; }
+	std::vector<unsigned char> b; unsigned char chunk[4096];
+	for( size_t n; (n=fread(chunk,1,sizeof(chunk),fp)) > 0; ) b.insert( b.end(), chunk, chunk+n );
+	fclose( fp );
+
+	size_t p = 0; bool b_valid = true;
+	auto bytes = [&]( int n ){ uint64_t v = 0; if(p+n>b.size()){ b_valid = false; return v; } for( int k=0; k < n; k++ ) v |= uint64_t(b[p++])<<(8*k); return v; };
+	auto varint = [&](){ uint64_t v = 0; for( int s=0; b_valid; s += 7 ){ if(p>=b.size()||s>63){ b_valid = false; break; } v |= uint64_t(b[p]&0x7f)<<s; if(!(b[p++]&0x80)) break; } return v; };
+	auto zigzag = [&](){ uint64_t v = varint(); return int(int64_t(v>>1)^-int64_t(v&1)); };
+	auto real = [&](){ uint64_t u = bytes(8); double v; memcpy( &v, &u, 8 ); return v; };
+
+	if(b.size()<4||memcmp(b.data(),"CGIR",4)!=0){ printf( "%s(): %s is not an input recording\n", __func__, path ); return false; }
+	p = 4; if(bytes(2)!=INPUT_FILE_VERSION){ printf( "%s(): unsupported version of %s\n", __func__, path ); return false; }
+	seed = uint(bytes(4)); dt = real(); size.x = int(bytes(2)); size.y = int(bytes(2));
+	events.clear(); int f = 0;
+	while( b_valid )
+	{
+		input_event e = { f += int(varint()), int(varint()), 0, 0, 0, 0, dvec2(0) };
+		if(e.type==INPUT_END){ frames = f; break; }
+		if(e.type==INPUT_KEY){ e.a = zigzag(); e.b = zigzag(); e.c = zigzag(); e.d = zigzag(); }
+		else if(e.type==INPUT_BUTTON){ e.a = zigzag(); e.b = zigzag(); e.c = zigzag(); e.pos.x = real(); e.pos.y = real(); }
+		else if(e.type==INPUT_CURSOR){ e.pos.x = real(); e.pos.y = real(); }
+		else if(e.type==INPUT_SIZE){ e.a = zigzag(); e.b = zigzag(); }
+		else b_valid = false;
+		if(b_valid) events.push_back( e );
+	}
+	if(!b_valid||!(dt>0)||size.x<=0||size.y<=0){ printf( "%s(): %s is truncated or corrupt\n", __func__, path ); return false; }
+	next = 0;
+	return true;
+}
+
+#endif // __REPLAY_H__
@@ -0,0 +1,98 @@
+#pragma once
+#ifndef __SCENE_H__
+#define __SCENE_H__
+#include <vector>
+#include "cgmath.h"
+
+//*************************************
+// product of two affine matrices (last row 0,0,0,1); 36 multiplies instead of 64
+inline mat4 affine_mul( const mat4& a, const mat4& b )
+{
+	mat4 m;
+	m._11 = a._11*b._11+a._12*b._21+a._13*b._31;	m._12 = a._11*b._12+a._12*b._22+a._13*b._32;	m._13 = a._11*b._13+a._12*b._23+a._13*b._33;	m._14 = a._11*b._14+a._12*b._24+a._13*b._34+a._14;
+	m._21 = a._21*b._11+a._22*b._21+a._23*b._31;	m._22 = a._21*b._12+a._22*b._22+a._23*b._32;	m._23 = a._21*b._13+a._22*b._23+a._23*b._33;	m._24 = a._21*b._14+a._22*b._24+a._23*b._34+a._24;
+	m._31 = a._31*b._11+a._32*b._21+a._33*b._31;	m._32 = a._31*b._12+a._32*b._22+a._33*b._32;	m._33 = a._31*b._13+a._32*b._23+a._33*b._33;	m._34 = a._31*b._14+a._32*b._24+a._33*b._34+a._34;
+	m._41 = 0; m._42 = 0; m._43 = 0; m._44 = 1;
+	return m;
+}
+
+//*************************************
+// body of the transform hierarchy (sun -> planet -> moon)
+// local transforms are built in closed form: revolution * translate for the orbit, rotation * scale for the body
+struct scene_node
+{
+	int		parent = -1;			// index of the parent node; parents always precede their children
+	vec3	offset;					// orbit offset from the parent, constant
+	float	radius = 1.0f;			// scale, constant
+	float	rotation_theta = 0.0f;	// self-rotating angle
+	float	revolution_theta = 0.0f;	// around-rotating angle
+	mat4	orbit_matrix;			// parent's orbit_matrix * revolution * translate; children attach to this frame
+	mat4	model_matrix;			// orbit_matrix * rotation * scale; the drawn transform
+	bool	b_orbit_dirty = true;	// revolution changed since the last update?
+	bool	b_model_dirty = true;	// rotation changed since the last update?
+	bool	b_moved = false;		// was orbit_matrix recomputed in the last update?
+};
+
+//*************************************
+// flat, topologically sorted hierarchy; update() walks the array once and
+// recomputes only the nodes whose own parameters or ancestors changed
+struct scene_graph
+{
+	std::vector<scene_node>	nodes;
+	uint	updated = 0;			// nodes recomputed in the last update
+
+	int		add( int parent, vec3 offset, float radius );
+	void	set_rotation( int k, float theta ){ scene_node& n=nodes[k]; if(n.rotation_theta!=theta){ n.rotation_theta=theta; n.b_model_dirty=true; } }
+	void	set_revolution( int k, float theta ){ scene_node& n=nodes[k]; if(n.revolution_theta!=theta){ n.revolution_theta=theta; n.b_orbit_dirty=true; } }
+	void	set_offset( int k, vec3 offset ){ scene_node& n=nodes[k]; if(n.offset.x!=offset.x||n.offset.y!=offset.y||n.offset.z!=offset.z){ n.offset=offset; n.b_orbit_dirty=true; } }
+	void	update();
+};
+
+inline int scene_graph::add( int parent, vec3 offset, float radius )
+{
+	scene_node n;
+	n.parent = parent;		// must already exist, so that the array stays topologically sorted
+	n.offset = offset;
+	n.radius = radius;
+	nodes.emplace_back(n);
+	return int(nodes.size())-1;
+}
+
+inline void scene_graph::update()
+{
+	updated = 0;
+	for( auto& n : nodes )
+	{
+		bool b_parent_moved = n.parent>=0 && nodes[n.parent].b_moved;
+		n.b_moved = n.b_orbit_dirty || b_parent_moved;
+		if(n.b_moved)
+		{
+			float c = cos(n.revolution_theta), s = sin(n.revolution_theta);
+			mat4 local =
+			{
+				c, -s, 0, c*n.offset.x - s*n.offset.y,
+				s, c, 0, s*n.offset.x + c*n.offset.y,
+				0, 0, 1, n.offset.z,
+				0, 0, 0, 1
+			};
+			n.orbit_matrix = n.parent<0 ? local : affine_mul( nodes[n.parent].orbit_matrix, local );
+			n.b_orbit_dirty = false;
+		}
+		if(n.b_moved||n.b_model_dirty)
+		{
+			float c = cos(n.rotation_theta)*n.radius, s = sin(n.rotation_theta)*n.radius;
+			mat4 body =
+			{
+				c, -s, 0, 0,
+				s, c, 0, 0,
+				0, 0, n.radius, 0,
+				0, 0, 0, 1
+			};
+			n.model_matrix = affine_mul( n.orbit_matrix, body );
+			n.b_model_dirty = false;
+			updated++;
+		}
+	}
+}
+
+#endif // __SCENE_H__
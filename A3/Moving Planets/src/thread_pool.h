@@ -0,0 +1,106 @@
+#pragma once
+#ifndef __THREAD_POOL_H__
+#define __THREAD_POOL_H__
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "cgmath.h"
+
+//*************************************
+// persistent worker threads; run() blocks until every task is done
+// the calling thread works on the tasks as well
+struct thread_pool
+{
+	thread_pool( uint num_workers );
+	~thread_pool();
+	uint	size() const { return uint(workers.size())+1; }
+	void	run( uint num_tasks, const std::function<void(uint)>& fn );
+
+private:
+	std::vector<std::thread>	workers;
+	std::mutex					mtx;
+	std::condition_variable		cv_work, cv_done;
+	const std::function<void(uint)>*	job = nullptr;
+	uint				num_tasks = 0;
+	std::atomic<uint>	next_task{0};
+	uint				busy = 0;			// workers not yet done with the current job
+	size_t				generation = 0;		// incremented for every job
+	bool				b_quit = false;
+
+	void	work_loop();
+	void	drain(){ for( uint t; (t=next_task++) < num_tasks; ) (*job)(t); }
+};
+
+inline thread_pool::thread_pool( uint num_workers )
+{
+	for( uint k=0; k < num_workers; k++ ) workers.emplace_back( [this](){ work_loop(); } );
+}
+
+inline thread_pool::~thread_pool()
+{
+	{ std::lock_guard<std::mutex> lock(mtx); b_quit = true; }
+	cv_work.notify_all();
+	for( auto& w : workers ) w.join();
+}
+
+inline void thread_pool::work_loop()
+{
+	size_t seen = 0;
+	for(;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mtx);
+			cv_work.wait( lock, [&](){ return b_quit||generation!=seen; } );
+			if(b_quit) return;
+			seen = generation;
+		}
+		drain();
+		std::lock_guard<std::mutex> lock(mtx);
+		if(--busy==0) cv_done.notify_one();
+	}
+}
+
+inline void thread_pool::run( uint tasks, const std::function<void(uint)>& fn )
+{
+	if(tasks==0) return;
+	if(tasks==1||workers.empty()){ for( uint t=0; t < tasks; t++ ) fn(t); return; }
+
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		job = &fn;
+		num_tasks = tasks;
+		next_task = 0;
+		busy = uint(workers.size());
+		generation++;
+	}
+	cv_work.notify_all();
+	drain();
+
+	// wait for the workers, so that none of them touches the job after returning
+	std::unique_lock<std::mutex> lock(mtx);
+	cv_done.wait( lock, [&](){ return busy==0; } );
+}
+
+//*************************************
+// process-wide pool with one thread per core
+inline thread_pool& default_thread_pool()
+{
+	static thread_pool pool( std::max(1u,std::thread::hardware_concurrency())-1 );
+	return pool;
+}
+
+// split [0,n) into at most num_tasks ranges of at least grain items; fn(begin,end)
+// range boundaries are multiples of 8 to keep SIMD kernels on full lanes
+template <class F> void parallel_for( uint num_tasks, size_t n, size_t grain, F fn )
+{
+	size_t chunks = std::min( size_t(num_tasks), (n+grain-1)/grain );
+	if(chunks<=1){ if(n) fn(size_t(0),n); return; }
+	size_t step = ((n+chunks-1)/chunks+7)&~size_t(7);
+	default_thread_pool().run( uint((n+step-1)/step), [&]( uint t ){ fn( t*step, std::min(n,t*step+step) ); } );
+}
+
+#endif // __THREAD_POOL_H__
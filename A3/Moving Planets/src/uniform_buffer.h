@@ -0,0 +1,68 @@
+#pragma once
+#ifndef __UNIFORM_BUFFER_H__
+#define __UNIFORM_BUFFER_H__
+#include <cstring>
+#include "cgmath.h"
+#include "cgut.h"
+#include "uniforms.h"	// gl_count()
+
+//*************************************
+// binding points of the uniform blocks; fixed so that every program can share the same buffers
+static const GLuint CAMERA_BINDING = 0;
+
+// std140 layout of the "camera" block of the shaders; mat4 is 16-byte aligned, so no padding is needed
+// the matrices stay row-major as in cgmath, and the block is declared row_major in GLSL
+struct camera_block
+{
+	mat4	view_matrix;
+	mat4	projection_matrix;
+	mat4	view_projection_matrix;		// projection_matrix * view_matrix
+};
+static_assert( sizeof(camera_block)==3*64, "camera_block does not match the std140 layout" );
+
+//*************************************
+// uniform buffer bound to a fixed binding point; update() skips the upload when the value has not changed
+template <class T> struct uniform_buffer
+{
+	GLuint	id = 0;
+	GLuint	binding = 0;
+	T		value;				// the last uploaded value
+	bool	b_valid = false;	// has a value been uploaded?
+
+	void	create( GLuint binding );
+	void	destroy(){ if(id) glDeleteBuffers( 1, &id ); id = 0; b_valid = false; }
+	bool	update( const T& v );
+	bool	attach( GLuint program, const char* block_name ) const;
+};
+
+template <class T> void uniform_buffer<T>::create( GLuint _binding )
+{
+	destroy();
+	binding = _binding;
+	glGenBuffers( 1, &id );
+	glBindBuffer( GL_UNIFORM_BUFFER, id );
+	glBufferData( GL_UNIFORM_BUFFER, sizeof(T), nullptr, GL_DYNAMIC_DRAW );
+	glBindBuffer( GL_UNIFORM_BUFFER, 0 );
+	glBindBufferBase( GL_UNIFORM_BUFFER, binding, id );
+}
+
+template <class T> bool uniform_buffer<T>::update( const T& v )
+{
+	if(b_valid&&memcmp(&value,&v,sizeof(T))==0){ gl_calls().skipped++; return false; }
+	value = v; b_valid = true;
+	glBindBuffer( GL_UNIFORM_BUFFER, id );
+	glBufferSubData( GL_UNIFORM_BUFFER, 0, sizeof(T), &value );
+	gl_count(2);
+	return true;
+}
+
+// connect the named block of a program to the binding point; false when the program does not use the block
+template <class T> bool uniform_buffer<T>::attach( GLuint program, const char* block_name ) const
+{
+	GLuint index = glGetUniformBlockIndex( program, block_name );
+	if(index==GL_INVALID_INDEX) return false;
+	glUniformBlockBinding( program, index, binding );
+	return true;
+}
+
+#endif // __UNIFORM_BUFFER_H__